@@ -1,7 +1,12 @@
 #include "Application.hpp"
+#include "Profiler/CpuProfiler.hpp"
 #include "spdlog/spdlog.h"
 
+#include <cstdlib>
+#include <algorithm>
+
 using LoopEngine::Application;
+using LoopEngine::ApplicationOptions;
 using LoopEngine::Core::Singleton;
 using LoopEngine::Platform::Window;
 using LoopEngine::Graphics::Context;
@@ -11,23 +16,61 @@ using LoopEngine::Event::EventSystem;
 using LoopEngine::Camera::CameraSystem;
 
 using LoopEngine::Event::InitEvent;
-using LoopEngine::Event::BeforeDrawEvent;
-using LoopEngine::Event::DrawEvent;
-using LoopEngine::Event::AfterDrawEvent;
 using LoopEngine::Event::QuitEvent;
 using LoopEngine::Event::UpdateEvent;
 using LoopEngine::Event::EventHandler;
 
 template<> Application* Singleton<Application>::instance = nullptr;
 
-Application::Application(const char *title, int width, int height) : window(width, height, title) {
-    context.initialize();
-    graphics.initialize();
+static auto get_environment(const char* name) -> std::string {
+    auto value = std::getenv(name);
+    return value != nullptr ? std::string(value) : std::string();
+}
+
+auto ApplicationOptions::from_environment() -> ApplicationOptions {
+    ApplicationOptions options{};
+
+    auto headless = get_environment("LOOP_HEADLESS");
+    options.headless = !headless.empty() && headless != "0";
+
+    auto frame_count = get_environment("LOOP_FRAME_COUNT");
+    if (!frame_count.empty()) {
+        options.frame_count = std::stoull(frame_count);
+    }
+
+    options.readback_directory = get_environment("LOOP_READBACK_DIR");
+
+    auto readback_interval = get_environment("LOOP_READBACK_INTERVAL");
+    if (!readback_interval.empty()) {
+        options.readback_interval = std::max(static_cast<uint32_t>(std::stoul(readback_interval)), 1u);
+    }
+
+    options.device = get_environment("LOOP_DEVICE");
+
+    auto occlusion_culling = get_environment("LOOP_OCCLUSION_CULLING");
+    options.occlusion_culling = occlusion_culling != "0";
+
+    auto dynamic_resolution = get_environment("LOOP_DYNAMIC_RESOLUTION");
+    options.dynamic_resolution = dynamic_resolution.empty() ? !options.headless : dynamic_resolution != "0";
+    return options;
+}
+
+Application::Application(const char *title, int width, int height) : Application(title, width, height, ApplicationOptions::from_environment()) {}
+
+Application::Application(const char *title, int width, int height, const ApplicationOptions& options) : options(options), window(width, height, title, options.headless) {
+    if (options.headless) {
+        spdlog::info("Running headless, {}x{}", width, height);
+    }
+    context.initialize(options.headless, options.device);
+    // graphics loads its engine shaders from the assets
     asset_system.initialize();
+    graphics.initialize();
     input_system.load_config("input.yaml");
 }
 
 void Application::run() {
+    LOOP_PROFILE_THREAD("Main");
+
     using as_seconds = std::chrono::duration<float, std::chrono::seconds::period>;
     auto queue = EventSystem::get_global_event_queue();
 
@@ -36,57 +79,64 @@ void Application::run() {
 
     float time_since_start = 0.0f;
     auto start_time = std::chrono::high_resolution_clock::now();
+    uint64_t frame_count = 0;
     while (!window.should_close()) {
+        if (options.frame_count > 0 && frame_count >= options.frame_count) {
+            break;
+        }
+
+        LOOP_PROFILE_SCOPE("Frame");
+
+        // waiting for the GPU before input is polled keeps the input of a frame as fresh as possible
+        {
+            LOOP_PROFILE_SCOPE("WaitForFrame");
+            graphics.begin_frame();
+        }
+
         auto current_time = std::chrono::high_resolution_clock::now();
         auto delta_time = as_seconds(current_time - start_time).count();
         start_time = current_time;
         time_since_start += delta_time;
 
-        window.poll_events();
-        input_system.update(delta_time);
-        queue->send_event(UpdateEvent{delta_time});
+        {
+            LOOP_PROFILE_SCOPE("Input");
+            window.poll_events();
+            input_system.update(delta_time);
+        }
+        {
+            LOOP_PROFILE_SCOPE("Update");
+            queue->send_event(UpdateEvent{delta_time});
+        }
+        // events posted by input and update handlers or sent by other threads are seen before the frame is recorded
+        {
+            LOOP_PROFILE_SCOPE("FlushEvents");
+            EventSystem::get_global_event_channel()->drain(*queue);
+            queue->flush_events();
+        }
 
         auto result = graphics.setup_frame();
         if (result == vk::Result::eErrorOutOfDateKHR) {
+            if (graphics.is_swapchain_outdated()) {
+                // nothing can be presented while minimized, sleep until the window changes
+                window.wait_events(0.1);
+            }
             continue;
         }
 
-        auto cmd = graphics.get_current_frame_command_buffer();
-        auto rect = vk::Rect2D{{0, 0}, graphics.get_surface_extent()};
-
-        std::array<vk::ClearValue, 2> clear_values{};
-        clear_values[0].setColor(vk::ClearColorValue{}.setFloat32({0.0f, 0.0f, 0.0f, 1.0f}));
-        clear_values[1].setDepthStencil(vk::ClearDepthStencilValue{}.setDepth(1.0f).setStencil(0));
-
-        // begin render pass
-        vk::RenderPassBeginInfo render_pass_begin_info{};
-        render_pass_begin_info.setRenderPass(graphics.get_default_render_pass());
-        render_pass_begin_info.setFramebuffer(graphics.get_current_swapchain_framebuffer());
-        render_pass_begin_info.setRenderArea(rect);
-        render_pass_begin_info.setClearValues(clear_values);
-        cmd.beginRenderPass(render_pass_begin_info, vk::SubpassContents::eInline);
-
-        vk::Viewport viewport{};
-        viewport.setWidth(static_cast<float>(rect.extent.width));
-        viewport.setHeight(static_cast<float>(rect.extent.height));
-        viewport.setMinDepth(0.0f);
-        viewport.setMaxDepth(1.0f);
-
-        cmd.setScissor(0, rect);
-        cmd.setViewport(0, viewport);
-
-        queue->send_event(BeforeDrawEvent{cmd});
-        queue->send_event(DrawEvent{cmd});
-        queue->send_event(AfterDrawEvent{cmd});
-
-        cmd.endRenderPass();
+        {
+            LOOP_PROFILE_SCOPE("Record");
+            graphics.execute_frame_graph();
+        }
 
         result = graphics.submit_frame();
+        frame_count += 1;
         if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
             continue;
         }
     }
     context.device.waitIdle();
+    EventSystem::get_global_event_channel()->drain(*queue);
+    queue->flush_events();
     queue->send_event(QuitEvent{});
 }
 
@@ -95,7 +145,7 @@ auto Application::get_window() -> LoopEngine::Platform::Window& {
 }
 
 LoopEngine::Application::~Application() {
-    asset_system.terminate();
     graphics.terminate();
+    asset_system.terminate();
     context.terminate();
 }
@@ -7,17 +7,49 @@
 #include "Event/EventSystem.hpp"
 #include "Camera/CameraSystem.hpp"
 #include "Asset/AssetSystem.hpp"
+#include "Job/JobSystem.hpp"
+
+#include <string>
 
 namespace LoopEngine {
+    struct ApplicationOptions {
+        // renders into offscreen images without a window or a presentable surface
+        bool headless = false;
+        // the application quits after this many frames, zero runs until the window is closed
+        uint64_t frame_count = 0;
+        // headless frames are written to this directory as ppm images when it is not empty
+        std::string readback_directory{};
+        uint32_t readback_interval = 1;
+        // index or part of the name of the physical device, the best suited device is used when it is empty
+        std::string device{};
+        // builds the depth pyramid used for occlusion culling, without it the depth buffer is never stored
+        // and lives in lazily allocated memory where the device supports it
+        bool occlusion_culling = true;
+        // scales the resolution of the scene with the GPU frame time, off by default when headless
+        // so the read back frames do not depend on the speed of the device
+        bool dynamic_resolution = true;
+
+        // reads LOOP_HEADLESS, LOOP_FRAME_COUNT, LOOP_READBACK_DIR, LOOP_READBACK_INTERVAL, LOOP_DEVICE,
+        // LOOP_OCCLUSION_CULLING and LOOP_DYNAMIC_RESOLUTION
+        static auto from_environment() -> ApplicationOptions;
+    };
+
     struct Application final : public LoopEngine::Core::Singleton<Application> {
         Application(const char *title, int width, int height);
+        Application(const char *title, int width, int height, const ApplicationOptions& options);
         ~Application();
 
         void run();
         auto get_window() -> LoopEngine::Platform::Window&;
 
+        [[nodiscard]] auto get_options() const -> const ApplicationOptions& {
+            return options;
+        }
+
     private:
+        ApplicationOptions options;
         LoopEngine::Platform::Window window;
+        LoopEngine::Job::JobSystem job_system{};
         LoopEngine::Graphics::Context context{};
         LoopEngine::Graphics::Graphics graphics{context};
         LoopEngine::Asset::AssetSystem asset_system{};
@@ -0,0 +1,302 @@
+#include "FrustumCulling.hpp"
+
+#include "LoopEngine/Camera/Camera.hpp"
+#include "LoopEngine/Job/JobSystem.hpp"
+#include "LoopEngine/Profiler/CpuProfiler.hpp"
+
+#include <bit>
+#include <algorithm>
+
+// the widest instruction set enabled for the build is used, there is no runtime dispatch
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LOOP_CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOP_CULLING_SSE
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define LOOP_CULLING_NEON
+#endif
+
+using LoopEngine::Job::JobSystem;
+using LoopEngine::Culling::Frustum;
+using LoopEngine::Culling::BoundingBoxes;
+using LoopEngine::Culling::BoundingSpheres;
+
+namespace {
+#if defined(LOOP_CULLING_AVX)
+    using Lanes = __m256;
+    using Mask = __m256;
+    constexpr size_t lane_count = 8;
+
+    inline auto load(const float* data) -> Lanes { return _mm256_loadu_ps(data); }
+    inline auto broadcast(float value) -> Lanes { return _mm256_set1_ps(value); }
+    inline auto negate(Lanes a) -> Lanes { return _mm256_sub_ps(_mm256_setzero_ps(), a); }
+    inline auto multiply_add(Lanes a, Lanes b, Lanes c) -> Lanes { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+    inline auto greater_equal(Lanes a, Lanes b) -> Mask { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    inline auto all_set() -> Mask { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    inline auto mask_and(Mask a, Mask b) -> Mask { return _mm256_and_ps(a, b); }
+    inline auto to_bits(Mask mask) -> uint32_t { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+#elif defined(LOOP_CULLING_SSE)
+    using Lanes = __m128;
+    using Mask = __m128;
+    constexpr size_t lane_count = 4;
+
+    inline auto load(const float* data) -> Lanes { return _mm_loadu_ps(data); }
+    inline auto broadcast(float value) -> Lanes { return _mm_set1_ps(value); }
+    inline auto negate(Lanes a) -> Lanes { return _mm_sub_ps(_mm_setzero_ps(), a); }
+    inline auto multiply_add(Lanes a, Lanes b, Lanes c) -> Lanes { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    inline auto greater_equal(Lanes a, Lanes b) -> Mask { return _mm_cmpge_ps(a, b); }
+    inline auto all_set() -> Mask { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+    inline auto mask_and(Mask a, Mask b) -> Mask { return _mm_and_ps(a, b); }
+    inline auto to_bits(Mask mask) -> uint32_t { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+#elif defined(LOOP_CULLING_NEON)
+    using Lanes = float32x4_t;
+    using Mask = uint32x4_t;
+    constexpr size_t lane_count = 4;
+
+    inline auto load(const float* data) -> Lanes { return vld1q_f32(data); }
+    inline auto broadcast(float value) -> Lanes { return vdupq_n_f32(value); }
+    inline auto negate(Lanes a) -> Lanes { return vnegq_f32(a); }
+    inline auto multiply_add(Lanes a, Lanes b, Lanes c) -> Lanes { return vmlaq_f32(c, a, b); }
+    inline auto greater_equal(Lanes a, Lanes b) -> Mask { return vcgeq_f32(a, b); }
+    inline auto all_set() -> Mask { return vdupq_n_u32(~0u); }
+    inline auto mask_and(Mask a, Mask b) -> Mask { return vandq_u32(a, b); }
+    inline auto to_bits(Mask mask) -> uint32_t {
+        static constexpr uint32_t bits[4] = {1, 2, 4, 8};
+        return vaddvq_u32(vandq_u32(mask, vld1q_u32(bits)));
+    }
+#else
+    using Lanes = float;
+    using Mask = bool;
+    constexpr size_t lane_count = 1;
+
+    inline auto load(const float* data) -> Lanes { return *data; }
+    inline auto broadcast(float value) -> Lanes { return value; }
+    inline auto negate(Lanes a) -> Lanes { return -a; }
+    inline auto multiply_add(Lanes a, Lanes b, Lanes c) -> Lanes { return a * b + c; }
+    inline auto greater_equal(Lanes a, Lanes b) -> Mask { return a >= b; }
+    inline auto all_set() -> Mask { return true; }
+    inline auto mask_and(Mask a, Mask b) -> Mask { return a && b; }
+    inline auto to_bits(Mask mask) -> uint32_t { return mask ? 1u : 0u; }
+#endif
+
+    // multiple of every lane count, so only the last chunk has a scalar tail
+    constexpr size_t chunk_size = 4096;
+
+    struct PlaneLanes {
+        Lanes x, y, z, w;
+    };
+
+    auto broadcast_planes(const Frustum& frustum) -> std::array<PlaneLanes, 6> {
+        std::array<PlaneLanes, 6> planes{};
+        for (size_t i = 0; i < planes.size(); i++) {
+            auto& plane = frustum.planes[i];
+            planes[i] = PlaneLanes{broadcast(plane.x), broadcast(plane.y), broadcast(plane.z), broadcast(plane.w)};
+        }
+        return planes;
+    }
+
+    auto write_indices(uint32_t bits, size_t first, uint32_t* out) -> size_t {
+        size_t count = 0;
+        while (bits != 0) {
+            out[count++] = static_cast<uint32_t>(first + std::countr_zero(bits));
+            bits &= bits - 1;
+        }
+        return count;
+    }
+
+    auto is_sphere_visible(const Frustum& frustum, const BoundingSpheres& spheres, size_t i) -> bool {
+        for (auto& plane : frustum.planes) {
+            auto distance = plane.x * spheres.center_x[i] + plane.y * spheres.center_y[i] + plane.z * spheres.center_z[i] + plane.w;
+            if (distance < -spheres.radius[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the box is outside if its corner furthest along the plane normal is behind the plane
+    auto is_box_visible(const Frustum& frustum, const BoundingBoxes& boxes, size_t i) -> bool {
+        for (auto& plane : frustum.planes) {
+            auto x = plane.x >= 0.0f ? boxes.max_x[i] : boxes.min_x[i];
+            auto y = plane.y >= 0.0f ? boxes.max_y[i] : boxes.min_y[i];
+            auto z = plane.z >= 0.0f ? boxes.max_z[i] : boxes.min_z[i];
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto cull_spheres_range(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* out) -> size_t {
+        auto planes = broadcast_planes(frustum);
+
+        size_t count = 0;
+        size_t i = begin;
+        for (; i + lane_count <= end; i += lane_count) {
+            auto x = load(&spheres.center_x[i]);
+            auto y = load(&spheres.center_y[i]);
+            auto z = load(&spheres.center_z[i]);
+            auto min_distance = negate(load(&spheres.radius[i]));
+
+            auto inside = all_set();
+            for (auto& plane : planes) {
+                auto distance = multiply_add(plane.x, x, multiply_add(plane.y, y, multiply_add(plane.z, z, plane.w)));
+                inside = mask_and(inside, greater_equal(distance, min_distance));
+            }
+            count += write_indices(to_bits(inside), i, out + count);
+        }
+        for (; i < end; i++) {
+            if (is_sphere_visible(frustum, spheres, i)) {
+                out[count++] = static_cast<uint32_t>(i);
+            }
+        }
+        return count;
+    }
+
+    auto cull_boxes_range(const Frustum& frustum, const BoundingBoxes& boxes, size_t begin, size_t end, uint32_t* out) -> size_t {
+        // the corner is picked per plane, so the selection is uniform across the lanes
+        std::array<std::array<const float*, 3>, 6> corners{};
+        for (size_t p = 0; p < corners.size(); p++) {
+            auto& plane = frustum.planes[p];
+            corners[p][0] = plane.x >= 0.0f ? boxes.max_x.data() : boxes.min_x.data();
+            corners[p][1] = plane.y >= 0.0f ? boxes.max_y.data() : boxes.min_y.data();
+            corners[p][2] = plane.z >= 0.0f ? boxes.max_z.data() : boxes.min_z.data();
+        }
+        auto planes = broadcast_planes(frustum);
+        auto zero = broadcast(0.0f);
+
+        size_t count = 0;
+        size_t i = begin;
+        for (; i + lane_count <= end; i += lane_count) {
+            auto inside = all_set();
+            for (size_t p = 0; p < planes.size(); p++) {
+                auto x = load(corners[p][0] + i);
+                auto y = load(corners[p][1] + i);
+                auto z = load(corners[p][2] + i);
+                auto distance = multiply_add(planes[p].x, x, multiply_add(planes[p].y, y, multiply_add(planes[p].z, z, planes[p].w)));
+                inside = mask_and(inside, greater_equal(distance, zero));
+            }
+            count += write_indices(to_bits(inside), i, out + count);
+        }
+        for (; i < end; i++) {
+            if (is_box_visible(frustum, boxes, i)) {
+                out[count++] = static_cast<uint32_t>(i);
+            }
+        }
+        return count;
+    }
+
+    template<typename CullRange>
+    void cull_chunks(size_t count, std::vector<uint32_t>& visible, const CullRange& cull_range) {
+        visible.resize(count);
+        if (count <= chunk_size) {
+            visible.resize(cull_range(0, count, visible.data()));
+            return;
+        }
+
+        // every chunk compacts into its own range of the output, the ranges are joined afterwards
+        auto chunk_count = (count + chunk_size - 1) / chunk_size;
+        std::vector<size_t> chunk_visible(chunk_count);
+        JobSystem::get_instance()->parallel_for(chunk_count, [&](size_t chunk, size_t thread_index) {
+            auto begin = chunk * chunk_size;
+            auto end = std::min(begin + chunk_size, count);
+            chunk_visible[chunk] = cull_range(begin, end, visible.data() + begin);
+        });
+
+        auto visible_count = chunk_visible[0];
+        for (size_t chunk = 1; chunk < chunk_count; chunk++) {
+            std::copy_n(visible.data() + chunk * chunk_size, chunk_visible[chunk], visible.data() + visible_count);
+            visible_count += chunk_visible[chunk];
+        }
+        visible.resize(visible_count);
+    }
+}
+
+auto LoopEngine::Culling::make_frustum(const glm::mat4& view_projection) -> Frustum {
+    auto row = [&](int i) {
+        return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+
+    Frustum frustum{};
+    frustum.planes = {
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2)
+    };
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+auto LoopEngine::Culling::get_camera_frustum(const LoopEngine::Camera::Camera& camera) -> Frustum {
+    return make_frustum(camera.get_projection_matrix() * camera.get_view_matrix());
+}
+
+void LoopEngine::Culling::BoundingSpheres::clear() {
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    radius.clear();
+}
+
+void LoopEngine::Culling::BoundingSpheres::reserve(size_t count) {
+    center_x.reserve(count);
+    center_y.reserve(count);
+    center_z.reserve(count);
+    radius.reserve(count);
+}
+
+void LoopEngine::Culling::BoundingSpheres::add(const glm::vec3& center, float radius) {
+    center_x.push_back(center.x);
+    center_y.push_back(center.y);
+    center_z.push_back(center.z);
+    this->radius.push_back(radius);
+}
+
+void LoopEngine::Culling::BoundingBoxes::clear() {
+    min_x.clear();
+    min_y.clear();
+    min_z.clear();
+    max_x.clear();
+    max_y.clear();
+    max_z.clear();
+}
+
+void LoopEngine::Culling::BoundingBoxes::reserve(size_t count) {
+    min_x.reserve(count);
+    min_y.reserve(count);
+    min_z.reserve(count);
+    max_x.reserve(count);
+    max_y.reserve(count);
+    max_z.reserve(count);
+}
+
+void LoopEngine::Culling::BoundingBoxes::add(const glm::vec3& min, const glm::vec3& max) {
+    min_x.push_back(min.x);
+    min_y.push_back(min.y);
+    min_z.push_back(min.z);
+    max_x.push_back(max.x);
+    max_y.push_back(max.y);
+    max_z.push_back(max.z);
+}
+
+void LoopEngine::Culling::cull_spheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible) {
+    LOOP_PROFILE_SCOPE("CullSpheres");
+    cull_chunks(spheres.size(), visible, [&](size_t begin, size_t end, uint32_t* out) {
+        return cull_spheres_range(frustum, spheres, begin, end, out);
+    });
+}
+
+void LoopEngine::Culling::cull_boxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible) {
+    LOOP_PROFILE_SCOPE("CullBoxes");
+    cull_chunks(boxes.size(), visible, [&](size_t begin, size_t end, uint32_t* out) {
+        return cull_boxes_range(frustum, boxes, begin, end, out);
+    });
+}
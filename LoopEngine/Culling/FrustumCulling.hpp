@@ -0,0 +1,60 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+namespace LoopEngine::Camera {
+    struct Camera;
+}
+
+namespace LoopEngine::Culling {
+    struct Frustum {
+        // xyz - normalized normal pointing inside, w - distance from the origin
+        std::array<glm::vec4, 6> planes{};
+    };
+
+    // planes of the clip space volume with depth in [0, 1]
+    extern auto make_frustum(const glm::mat4& view_projection) -> Frustum;
+    extern auto get_camera_frustum(const LoopEngine::Camera::Camera& camera) -> Frustum;
+
+    // bounding volumes are stored as structure of arrays, so several of them are tested at once with SIMD
+    struct BoundingSpheres {
+        std::vector<float> center_x{};
+        std::vector<float> center_y{};
+        std::vector<float> center_z{};
+        std::vector<float> radius{};
+
+        void clear();
+        void reserve(size_t count);
+        void add(const glm::vec3& center, float radius);
+
+        [[nodiscard]] auto size() const -> size_t {
+            return radius.size();
+        }
+    };
+
+    struct BoundingBoxes {
+        std::vector<float> min_x{};
+        std::vector<float> min_y{};
+        std::vector<float> min_z{};
+        std::vector<float> max_x{};
+        std::vector<float> max_y{};
+        std::vector<float> max_z{};
+
+        void clear();
+        void reserve(size_t count);
+        void add(const glm::vec3& min, const glm::vec3& max);
+
+        [[nodiscard]] auto size() const -> size_t {
+            return min_x.size();
+        }
+    };
+
+    // fill visible with the ascending indices of the volumes that intersect the frustum,
+    // large batches are split into chunks that run on the job system
+    extern void cull_spheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible);
+    extern void cull_boxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible);
+}
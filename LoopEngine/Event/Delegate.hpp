@@ -1,5 +1,9 @@
 #pragma once
 
+#include <new>
+#include <cstddef>
+#include <type_traits>
+
 namespace LoopEngine::Event {
     template<typename T>
     struct Delegate;
@@ -38,6 +42,56 @@ namespace LoopEngine::Event {
     template<typename R, typename ...T>
     Delegate(R(*)(T...)) -> Delegate<R(T...)>;
 
+    template<typename T, size_t capacity = 3 * sizeof(void*)>
+    struct InlineDelegate;
+
+    // Holds a callable with its captures inside of the delegate instead of on the heap. Only trivially copyable
+    // callables are accepted, so the delegate can be copied and relocated with memcpy and never runs a destructor.
+    // A Delegate created by get_delegate calls the stored callable directly and stays valid while this one does not move.
+    template<typename R, typename ...T, size_t capacity>
+    struct InlineDelegate<R(T...), capacity> {
+        using FunctionType = R(*)(void *, T...);
+
+        constexpr InlineDelegate() = default;
+
+        template<typename F>
+        requires (!std::is_same_v<std::remove_cvref_t<F>, InlineDelegate> && std::is_invocable_r_v<R, std::remove_cvref_t<F>&, T...>)
+        InlineDelegate(F&& callable) noexcept {
+            using Callable = std::remove_cvref_t<F>;
+            static_assert(sizeof(Callable) <= capacity, "captures are too large for the inline storage of the delegate");
+            static_assert(alignof(Callable) <= alignof(void*), "captures are over-aligned for the inline storage of the delegate");
+            static_assert(std::is_trivially_copyable_v<Callable> && std::is_trivially_destructible_v<Callable>, "captures of an inline delegate must be trivially copyable");
+
+            ::new (static_cast<void*>(storage)) Callable(static_cast<F&&>(callable));
+            function = &invoke<Callable>;
+        }
+
+        template<class... Args>
+        auto operator()(Args&&... args) -> R {
+            return function(storage, static_cast<Args&&>(args)...);
+        }
+
+        explicit constexpr operator bool() const noexcept {
+            return function != nullptr;
+        }
+
+        [[nodiscard]] auto get_delegate() noexcept -> Delegate<R(T...)> {
+            if (function == nullptr) {
+                return {};
+            }
+            return Delegate<R(T...)>{static_cast<void*>(storage), function};
+        }
+
+    private:
+        template<typename Callable>
+        static auto invoke(void *storage, T... args) -> R {
+            return (*std::launder(static_cast<Callable*>(storage)))(static_cast<T&&>(args)...);
+        }
+
+        alignas(void*) std::byte storage[capacity]{};
+        FunctionType function = nullptr;
+    };
+
     template<typename Self, typename R, typename ...T>
     Delegate(Self*, R(*)(Self*, T...)) -> Delegate<R(T...)>;
 
@@ -0,0 +1,36 @@
+#include "EventChannel.hpp"
+#include "EventSystem.hpp"
+
+#include <bit>
+#include <algorithm>
+
+using LoopEngine::Event::EventQueue;
+using LoopEngine::Event::EventChannel;
+
+EventChannel::EventChannel(size_t capacity) {
+    auto size = std::bit_ceil(std::max(capacity, size_t(2)));
+    slots = std::make_unique<Slot[]>(size);
+    mask = size - 1;
+
+    // a slot is free for the sender of the lap whose position matches its sequence
+    for (size_t i = 0; i < size; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+auto EventChannel::drain(EventQueue &queue) -> size_t {
+    size_t count = 0;
+    while (true) {
+        auto& slot = slots[read_position & mask];
+        // a claimed slot that is still being written stops the drain, later slots wait for the next one
+        if (slot.sequence.load(std::memory_order_acquire) != read_position + 1) {
+            break;
+        }
+
+        slot.post(queue, slot.storage);
+        slot.sequence.store(read_position + mask + 1, std::memory_order_release);
+        read_position += 1;
+        count += 1;
+    }
+    return count;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace LoopEngine::Event {
+    struct EventQueue;
+
+    // Bounded multi-producer single-consumer ring of events, any thread may send while the main thread drains it
+    // into an event queue. Senders claim a slot with a compare and swap of the write position and publish it through
+    // the sequence number of the slot, so sending never locks or allocates. Events are copied into the slot and must
+    // be trivially copyable and fit into max_event_size bytes.
+    struct EventChannel {
+        static constexpr size_t max_event_size = 48;
+        static constexpr size_t max_event_alignment = 16;
+
+        // the capacity is rounded up to a power of two
+        explicit EventChannel(size_t capacity);
+
+        // returns false when the channel is full, the event is dropped in that case
+        template<typename Event>
+        auto try_send(const Event &event) -> bool {
+            static_assert(std::is_trivially_copyable_v<Event>, "events sent through a channel must be trivially copyable");
+            static_assert(sizeof(Event) <= max_event_size, "event is too large for a channel slot");
+            static_assert(alignof(Event) <= max_event_alignment, "event is over-aligned for a channel slot");
+
+            auto position = write_position.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &slots[position & mask];
+                auto sequence = slot->sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+                if (difference == 0) {
+                    if (write_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    // the consumer has not freed the slot of the previous lap yet
+                    return false;
+                } else {
+                    position = write_position.load(std::memory_order_relaxed);
+                }
+            }
+
+            std::memcpy(slot->storage, std::addressof(event), sizeof(Event));
+            slot->post = &post_event<Event>;
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // main thread only, posts the events sent so far to the queue in the order they were claimed
+        // and returns their count, they are handled by the next flush of the queue
+        auto drain(EventQueue &queue) -> size_t;
+
+        [[nodiscard]] auto get_capacity() const -> size_t {
+            return mask + 1;
+        }
+
+    private:
+        using PostFunction = void(*)(EventQueue&, const void*);
+
+        // a slot per cache line, so producers writing neighbouring slots do not share one
+        struct alignas(64) Slot {
+            std::atomic<size_t> sequence{0};
+            PostFunction post = nullptr;
+            alignas(max_event_alignment) std::byte storage[max_event_size];
+        };
+
+        template<typename Event>
+        static void post_event(EventQueue &queue, const void *payload);
+
+        std::unique_ptr<Slot[]> slots{};
+        size_t mask = 0;
+
+        alignas(64) std::atomic<size_t> write_position{0};
+        alignas(64) size_t read_position = 0;
+    };
+}
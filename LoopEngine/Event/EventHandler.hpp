@@ -1,40 +1,251 @@
 #pragma once
 
 #include "Delegate.hpp"
+#include "LoopEngine/Core/DisableCopyAndMove.hpp"
+
+#include <span>
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
 
 namespace LoopEngine::Event {
-    struct IEventHandler {
-        virtual void handle(void *payload) = 0;
+    struct EventQueue;
+
+    using EventTypeId = uint32_t;
+
+    // ids are handed out in the order the event types are first used, so they stay small and dense
+    auto allocate_event_type_id() -> EventTypeId;
+
+    template<typename Event>
+    auto get_event_type_id() -> EventTypeId {
+        static const auto id = allocate_event_type_id();
+        return id;
+    }
+
+    // identifies a registered delegate until it is removed, a queue never reuses the id of a removed one
+    struct EventHandlerToken {
+        static constexpr EventTypeId invalid_type = std::numeric_limits<EventTypeId>::max();
+
+        EventTypeId type = invalid_type;
+        uint32_t id = 0;
+
+        explicit constexpr operator bool() const noexcept {
+            return type != invalid_type;
+        }
+    };
+
+    struct IEventHandlerList {
+        virtual ~IEventHandlerList() = default;
+        virtual void remove(uint32_t id) = 0;
+        // sends the posted events, events posted by the handlers wait for the next flush
+        virtual void flush() = 0;
+    };
+
+    // the delegates of one event type in registration order, dispatch is one indirect call per delegate,
+    // also keeps the events posted since the last flush contiguous in memory
+    template<typename Event>
+    struct EventHandlerList final : IEventHandlerList {
+        using DelegateType = Delegate<void(const Event&)>;
+        using BatchDelegateType = Delegate<void(std::span<const Event>)>;
+
+        auto add(DelegateType delegate) -> uint32_t {
+            auto id = next_id++;
+            ids.emplace_back(id);
+            delegates.emplace_back(or_ignore(delegate));
+            return id;
+        }
+
+        auto add_batch(BatchDelegateType delegate) -> uint32_t {
+            auto id = next_id++;
+            batch_ids.emplace_back(id);
+            batch_delegates.emplace_back(delegate);
+            return id;
+        }
+
+        void set(uint32_t id, DelegateType delegate) {
+            auto it = std::find(ids.begin(), ids.end(), id);
+            if (it != ids.end()) {
+                delegates[it - ids.begin()] = or_ignore(delegate);
+            }
+        }
+
+        // during dispatch the delegate is only replaced by a no-op, the entries are erased once the outermost dispatch returns
+        void remove(uint32_t id) override {
+            auto it = std::find(ids.begin(), ids.end(), id);
+            if (it != ids.end()) {
+                if (dispatch_depth > 0) {
+                    delegates[it - ids.begin()] = DelegateType{&ignore};
+                    *it = removed_id;
+                    has_removed = true;
+                } else {
+                    delegates.erase(delegates.begin() + (it - ids.begin()));
+                    ids.erase(it);
+                }
+            }
+
+            auto batch_it = std::find(batch_ids.begin(), batch_ids.end(), id);
+            if (batch_it != batch_ids.end()) {
+                if (dispatch_depth > 0) {
+                    batch_delegates[batch_it - batch_ids.begin()] = BatchDelegateType{&ignore_batch};
+                    *batch_it = removed_id;
+                    has_removed = true;
+                } else {
+                    batch_delegates.erase(batch_delegates.begin() + (batch_it - batch_ids.begin()));
+                    batch_ids.erase(batch_it);
+                }
+            }
+        }
+
+        // handlers may add or remove handlers of the same event, added ones are called for the current event as well,
+        // removed ones are not called anymore
+        void dispatch(const Event& event) {
+            dispatch_depth += 1;
+            for (size_t i = 0; i < delegates.size(); i++) {
+                // copied, a handler added by the call may reallocate the storage
+                auto delegate = delegates[i];
+                delegate(event);
+            }
+            for (size_t i = 0; i < batch_delegates.size(); i++) {
+                auto delegate = batch_delegates[i];
+                delegate(std::span<const Event>(&event, 1));
+            }
+            end_dispatch();
+        }
+
+        // every handler sees all events before the next one is called, batch handlers get them at once
+        void dispatch(std::span<const Event> events) {
+            dispatch_depth += 1;
+            for (size_t i = 0; i < delegates.size(); i++) {
+                for (auto& event : events) {
+                    // read for every event, the handler may remove itself
+                    auto delegate = delegates[i];
+                    delegate(event);
+                }
+            }
+            for (size_t i = 0; i < batch_delegates.size(); i++) {
+                auto delegate = batch_delegates[i];
+                delegate(events);
+            }
+            end_dispatch();
+        }
+
+        // returns true for the first event posted since the last flush
+        auto post(const Event& event) -> bool {
+            pending.emplace_back(event);
+            return pending.size() == 1;
+        }
+
+        void flush() override {
+            std::vector<Event> events{};
+            events.swap(pending);
+            dispatch(std::span<const Event>(events));
+
+            // the storage is handed back instead of freed, so posting stops allocating once it fits the usual event count
+            if (pending.empty()) {
+                events.clear();
+                pending.swap(events);
+            }
+        }
+
+    private:
+        static constexpr uint32_t removed_id = std::numeric_limits<uint32_t>::max();
+
+        static void ignore(const Event&) {}
+        static void ignore_batch(std::span<const Event>) {}
+
+        void end_dispatch() {
+            dispatch_depth -= 1;
+            if (dispatch_depth > 0 || !has_removed) {
+                return;
+            }
+            has_removed = false;
+
+            for (size_t i = ids.size(); i-- > 0;) {
+                if (ids[i] == removed_id) {
+                    delegates.erase(delegates.begin() + i);
+                    ids.erase(ids.begin() + i);
+                }
+            }
+            for (size_t i = batch_ids.size(); i-- > 0;) {
+                if (batch_ids[i] == removed_id) {
+                    batch_delegates.erase(batch_delegates.begin() + i);
+                    batch_ids.erase(batch_ids.begin() + i);
+                }
+            }
+        }
+
+        // handlers that are not connected yet are stored as a no-op, so dispatch needs no null check
+        static auto or_ignore(DelegateType delegate) -> DelegateType {
+            return delegate ? delegate : DelegateType{&ignore};
+        }
+
+        std::vector<DelegateType> delegates{};
+        std::vector<uint32_t> ids{};
+        std::vector<BatchDelegateType> batch_delegates{};
+        std::vector<uint32_t> batch_ids{};
+        uint32_t next_id = 0;
+        // nested dispatches of the same event, removals are deferred while it is not zero
+        uint32_t dispatch_depth = 0;
+        bool has_removed = false;
+
+        std::vector<Event> pending{};
     };
 
+    // keeps a delegate together with the token it is registered with, so it can be connected before or after it is added to a queue,
+    // the queue points into the handler, so it can not be copied or moved
     template<typename T>
-    struct EventHandler : IEventHandler {
+    struct EventHandler : private LoopEngine::Core::DisableCopyAndMove {
         using Event = T;
 
         template<auto function, typename Self>
-        constexpr auto connect(Self *object) noexcept {
-            delegate = Delegate{object, as_static_function<function>()};
+        auto connect(Self *object) noexcept {
+            set(Delegate{object, as_static_function<function>()});
         }
-        constexpr auto connect(void(*function)(const Event&)) noexcept {
-            delegate = Delegate{function};
+        auto connect(void(*function)(const Event&)) noexcept {
+            set(Delegate{function});
         }
 
         template<typename Self>
-        constexpr auto connect(Self *object, void(*function)(Self*, const Event&)) noexcept {
-            delegate = Delegate{object, function};
+        auto connect(Self *object, void(*function)(Self*, const Event&)) noexcept {
+            set(Delegate{object, function});
         }
 
-        constexpr void reset() noexcept {
-            delegate = {};
+        void reset() noexcept {
+            set({});
         }
 
-    private:
-        void handle(void *payload) override {
-            if (delegate) {
-                delegate(*static_cast<const Event*>(payload));
+    protected:
+        void set(Delegate<void(const Event&)> delegate) noexcept {
+            this->delegate = delegate;
+            if (list != nullptr) {
+                list->set(token.id, delegate);
             }
         }
 
-        Delegate<void(const Event&)> delegate;
+    private:
+        friend struct EventQueue;
+
+        Delegate<void(const Event&)> delegate{};
+        EventHandlerList<Event>* list = nullptr;
+        EventHandlerToken token{};
+    };
+
+    // an event handler that can also be connected to a capturing lambda, the captures are stored inside of the handler
+    template<typename T>
+    struct LambdaEventHandler : EventHandler<T> {
+        using Event = T;
+        using EventHandler<T>::connect;
+
+        // larger or non trivially copyable captures are rejected at compile time
+        template<typename F>
+        requires (std::is_invocable_r_v<void, F&, const Event&> && !std::is_convertible_v<F, void(*)(const Event&)>)
+        auto connect(F function) noexcept {
+            callable = InlineDelegate<void(const Event&)>{function};
+            this->set(callable.get_delegate());
+        }
+
+    private:
+        InlineDelegate<void(const Event&)> callable{};
     };
-}
\ No newline at end of file
+}
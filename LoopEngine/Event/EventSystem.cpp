@@ -1,7 +1,15 @@
 #include "EventSystem.hpp"
 #include "LoopEngine/Application.hpp"
 
+#include <atomic>
+
 using LoopEngine::Core::Singleton;
 using LoopEngine::Event::EventSystem;
+using LoopEngine::Event::EventTypeId;
+
+template<> EventSystem* Singleton<EventSystem>::instance = nullptr;
 
-template<> EventSystem* Singleton<EventSystem>::instance = nullptr;
\ No newline at end of file
+auto LoopEngine::Event::allocate_event_type_id() -> EventTypeId {
+    static std::atomic<EventTypeId> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
@@ -1,10 +1,11 @@
 #pragma once
 
 #include "EventHandler.hpp"
+#include "EventChannel.hpp"
 #include "LoopEngine/Core/Singleton.hpp"
 
-#include <set>
-#include <unordered_map>
+#include <memory>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 
 namespace LoopEngine::Event {
@@ -18,6 +19,7 @@ namespace LoopEngine::Event {
     struct DrawEvent {
         vk::CommandBuffer cmd;
     };
+    // sent at the resolution of the surface after the scene has been upscaled
     struct AfterDrawEvent {
         vk::CommandBuffer cmd;
     };
@@ -26,38 +28,100 @@ namespace LoopEngine::Event {
     struct EventQueue {
         template<typename Event>
         void send_event(const Event &event) {
-            auto it = handlers.find(typeid(Event).hash_code());
-            if (it != handlers.end()) {
-                for (auto &handler: it->second) {
-                    handler->handle((void *) std::addressof(event));
-                }
+            auto id = get_event_type_id<Event>();
+            if (id < handlers.size() && handlers[id]) {
+                static_cast<EventHandlerList<Event> *>(handlers[id].get())->dispatch(event);
             }
         }
 
-        template<typename Self>
-        requires std::is_base_of_v<IEventHandler, Self>
-        void add_event_handler(Self *handler) {
-            handlers[typeid(typename Self::Event).hash_code()].emplace_back(handler);
+        // copies the event, it is sent together with the other events of its type by the next flush
+        template<typename Event>
+        void post_event(const Event &event) {
+            if (get_handler_list<Event>().post(event)) {
+                posted_types.emplace_back(get_event_type_id<Event>());
+            }
+        }
+
+        // sends the posted events grouped by type, in the order the types were first posted
+        void flush_events() {
+            std::vector<EventTypeId> types{};
+            types.swap(posted_types);
+            for (auto type : types) {
+                handlers[type]->flush();
+            }
+
+            if (posted_types.empty()) {
+                types.clear();
+                posted_types.swap(types);
+            }
+        }
+
+        template<typename Event>
+        auto add_event_handler(Delegate<void(const Event&)> delegate) -> EventHandlerToken {
+            return EventHandlerToken{get_event_type_id<Event>(), get_handler_list<Event>().add(delegate)};
+        }
+
+        // the delegate receives all events of a flush at once, sent events arrive as a span of one
+        template<typename Event>
+        auto add_batch_event_handler(Delegate<void(std::span<const Event>)> delegate) -> EventHandlerToken {
+            return EventHandlerToken{get_event_type_id<Event>(), get_handler_list<Event>().add_batch(delegate)};
+        }
+
+        void remove_event_handler(EventHandlerToken token) {
+            if (token && token.type < handlers.size() && handlers[token.type]) {
+                handlers[token.type]->remove(token.id);
+            }
         }
 
-        template<typename Self>
-        requires std::is_base_of_v<IEventHandler, Self>
-        void remove_event_handler(Self *handler) {
-            auto it = handlers.find(typeid(typename Self::Event).hash_code());
-            it->second.erase(std::remove(it->second.begin(), it->second.end(), handler), it->second.end());
+        template<typename Event>
+        void add_event_handler(EventHandler<Event> *handler) {
+            handler->token = add_event_handler<Event>(handler->delegate);
+            handler->list = &get_handler_list<Event>();
+        }
+
+        template<typename Event>
+        void remove_event_handler(EventHandler<Event> *handler) {
+            remove_event_handler(handler->token);
+            handler->token = {};
+            handler->list = nullptr;
         }
 
     private:
-        std::unordered_map<size_t, std::vector<IEventHandler *>> handlers{};
+        template<typename Event>
+        auto get_handler_list() -> EventHandlerList<Event>& {
+            auto id = get_event_type_id<Event>();
+            if (id >= handlers.size()) {
+                handlers.resize(id + 1);
+            }
+            if (!handlers[id]) {
+                handlers[id] = std::make_unique<EventHandlerList<Event>>();
+            }
+            return *static_cast<EventHandlerList<Event> *>(handlers[id].get());
+        }
+
+        // indexed by the event type id, the lists never move so handlers can keep pointers to them
+        std::vector<std::unique_ptr<IEventHandlerList>> handlers{};
+        std::vector<EventTypeId> posted_types{};
     };
 
+    template<typename Event>
+    void EventChannel::post_event(EventQueue &queue, const void *payload) {
+        queue.post_event(*std::launder(static_cast<const Event *>(payload)));
+    }
+
     struct EventSystem : LoopEngine::Core::Singleton<EventSystem> {
         static auto get_global_event_queue() -> EventQueue* {
             return &get_instance()->global_event_queue;
         }
 
+        // thread safe, drained into the global queue once per frame before its posted events are flushed
+        static auto get_global_event_channel() -> EventChannel* {
+            return &get_instance()->global_event_channel;
+        }
+
     private:
         EventQueue global_event_queue{};
+        EventChannel global_event_channel{4096};
     };
 
 
@@ -0,0 +1,127 @@
+#include "CommandRecorder.hpp"
+#include "Context.hpp"
+#include "LoopEngine/Job/JobSystem.hpp"
+#include "LoopEngine/Profiler/CpuProfiler.hpp"
+
+using LoopEngine::Job::JobSystem;
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::CommandRecorder;
+
+CommandRecorder::CommandRecorder(Context& context) : context(context) {}
+
+void CommandRecorder::initialize(size_t frame_count, size_t thread_count) {
+    vk::CommandPoolCreateInfo pool_create_info{};
+    pool_create_info.setQueueFamilyIndex(context.graphics_queue_family_index);
+    pool_create_info.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+
+    pools.resize(frame_count);
+    for (auto& frame_pools : pools) {
+        frame_pools.resize(thread_count);
+        for (auto& thread_pool : frame_pools) {
+            thread_pool.pool = context.device.createCommandPool(pool_create_info);
+        }
+    }
+}
+
+void CommandRecorder::terminate() {
+    for (auto& frame_pools : pools) {
+        for (auto& thread_pool : frame_pools) {
+            // destroying the pool frees its command buffers
+            context.device.destroyCommandPool(thread_pool.pool);
+        }
+    }
+    pools.clear();
+}
+
+void CommandRecorder::reset_frame(size_t frame) {
+    for (auto& thread_pool : pools[frame]) {
+        if (thread_pool.used > 0) {
+            context.device.resetCommandPool(thread_pool.pool);
+            thread_pool.used = 0;
+        }
+    }
+}
+
+void CommandRecorder::begin_pass(size_t frame, vk::RenderPass render_pass, vk::Framebuffer framebuffer, const vk::Rect2D& area) {
+    current_frame = frame;
+    render_area = area;
+
+    inheritance_info = vk::CommandBufferInheritanceInfo{};
+    inheritance_info.setRenderPass(render_pass);
+    inheritance_info.setSubpass(0);
+    inheritance_info.setFramebuffer(framebuffer);
+
+    recorded.clear();
+}
+
+auto CommandRecorder::end_pass() -> const std::vector<vk::CommandBuffer>& {
+    return recorded;
+}
+
+auto CommandRecorder::begin_secondary(size_t thread_index) -> vk::CommandBuffer {
+    auto& thread_pool = pools[current_frame][thread_index];
+    if (thread_pool.used == thread_pool.buffers.size()) {
+        vk::CommandBufferAllocateInfo alloc_info{};
+        alloc_info.setCommandPool(thread_pool.pool);
+        alloc_info.setLevel(vk::CommandBufferLevel::eSecondary);
+        alloc_info.setCommandBufferCount(1);
+        thread_pool.buffers.emplace_back(context.device.allocateCommandBuffers(alloc_info).front());
+    }
+    auto cmd = thread_pool.buffers[thread_pool.used++];
+
+    vk::CommandBufferBeginInfo begin_info{};
+    begin_info.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue);
+    begin_info.setPInheritanceInfo(&inheritance_info);
+    cmd.begin(begin_info);
+
+    // dynamic state is not inherited by secondary command buffers
+    vk::Viewport viewport{};
+    viewport.setX(static_cast<float>(render_area.offset.x));
+    viewport.setY(static_cast<float>(render_area.offset.y));
+    viewport.setWidth(static_cast<float>(render_area.extent.width));
+    viewport.setHeight(static_cast<float>(render_area.extent.height));
+    viewport.setMinDepth(0.0f);
+    viewport.setMaxDepth(1.0f);
+
+    cmd.setScissor(0, render_area);
+    cmd.setViewport(0, viewport);
+    return cmd;
+}
+
+void CommandRecorder::end_secondary(vk::CommandBuffer cmd) {
+    cmd.end();
+    recorded.push_back(cmd);
+}
+
+void CommandRecorder::record(RecordFunction function) {
+    tasks.emplace_back(std::move(function));
+}
+
+void CommandRecorder::record_tasks() {
+    if (tasks.empty()) {
+        return;
+    }
+
+    LOOP_PROFILE_SCOPE("RecordTasks");
+
+    auto job_system = JobSystem::get_instance();
+    auto chunk_count = std::min(tasks.size(), job_system->get_thread_count() * 2);
+
+    std::vector<vk::CommandBuffer> chunks(chunk_count);
+    job_system->parallel_for(chunk_count, [&](size_t chunk, size_t thread_index) {
+        LOOP_PROFILE_SCOPE("RecordChunk");
+
+        auto begin = tasks.size() * chunk / chunk_count;
+        auto end = tasks.size() * (chunk + 1) / chunk_count;
+
+        auto cmd = begin_secondary(thread_index);
+        for (auto i = begin; i < end; i++) {
+            tasks[i](cmd);
+        }
+        cmd.end();
+        chunks[chunk] = cmd;
+    });
+
+    recorded.insert(recorded.end(), chunks.begin(), chunks.end());
+    tasks.clear();
+}
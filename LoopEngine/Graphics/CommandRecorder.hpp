@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <functional>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+
+    using RecordFunction = std::function<void(vk::CommandBuffer)>;
+
+    // Records secondary command buffers for a render pass. Every thread of the job system owns one
+    // command pool per frame in flight, the pools are reset wholesale when the frame is reused.
+    struct CommandRecorder {
+        explicit CommandRecorder(Context& context);
+
+        void initialize(size_t frame_count, size_t thread_count);
+        void terminate();
+
+        // must only be called once the GPU has finished the frame
+        void reset_frame(size_t frame);
+
+        void begin_pass(size_t frame, vk::RenderPass render_pass, vk::Framebuffer framebuffer, const vk::Rect2D& area);
+        auto end_pass() -> const std::vector<vk::CommandBuffer>&;
+
+        // the returned command buffer inherits the render pass and has viewport and scissor set
+        auto begin_secondary(size_t thread_index) -> vk::CommandBuffer;
+        void end_secondary(vk::CommandBuffer cmd);
+
+        // queues a task from the main thread, tasks are recorded by the job system in contiguous
+        // chunks and executed in the order they were queued
+        void record(RecordFunction function);
+        void record_tasks();
+
+    private:
+        struct ThreadPool {
+            vk::CommandPool pool{};
+            std::vector<vk::CommandBuffer> buffers{};
+            size_t used = 0;
+        };
+
+        Context& context;
+        std::vector<std::vector<ThreadPool>> pools{};
+
+        size_t current_frame = 0;
+        vk::Rect2D render_area{};
+        vk::CommandBufferInheritanceInfo inheritance_info{};
+
+        std::vector<RecordFunction> tasks{};
+        std::vector<vk::CommandBuffer> recorded{};
+    };
+}
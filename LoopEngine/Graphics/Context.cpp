@@ -10,6 +10,10 @@
 #include "spdlog/spdlog.h"
 
 #include <set>
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <string_view>
 #include <vulkan/vulkan_beta.h>
 
 using LoopEngine::Core::Singleton;
@@ -55,13 +59,53 @@ static auto select_depth_format(vk::PhysicalDevice device) -> vk::Format {
     return get_supported_format(device, formats, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
 }
 
+static auto get_device_type_score(vk::PhysicalDeviceType type) -> uint64_t {
+    switch (type) {
+        case vk::PhysicalDeviceType::eDiscreteGpu: return 4;
+        case vk::PhysicalDeviceType::eIntegratedGpu: return 3;
+        case vk::PhysicalDeviceType::eVirtualGpu: return 2;
+        case vk::PhysicalDeviceType::eOther: return 1;
+        default: return 0;
+    }
+}
+
+static auto has_queue_family(const std::vector<vk::QueueFamilyProperties>& families, vk::QueueFlags required, vk::QueueFlags excluded) -> bool {
+    for (auto& family : families) {
+        if ((family.queueFlags & required) == required && !(family.queueFlags & excluded)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static auto get_device_local_memory(vk::PhysicalDevice device) -> vk::DeviceSize {
+    vk::DeviceSize size = 0;
+    auto properties = device.getMemoryProperties();
+    for (uint32_t i = 0; i < properties.memoryHeapCount; i++) {
+        if (properties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+            size = std::max(size, properties.memoryHeaps[i].size);
+        }
+    }
+    return size;
+}
+
+static auto to_lower(std::string_view text) -> std::string {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return result;
+}
+
 template<> Context* Singleton<Context>::instance = nullptr;
 
-void Context::initialize() {
+void Context::initialize(bool is_headless, const std::string& preferred_device) {
+    headless = is_headless;
+
     spdlog::info("Initializing Vulkan");
     create_instance();
     create_debug_utils();
-    select_physical_device();
+    select_physical_device(preferred_device);
     create_logical_device();
     create_memory_allocator();
     spdlog::info("Vulkan initialized");
@@ -87,7 +131,12 @@ void Context::terminate() {
 }
 
 void Context::create_instance() {
-    VULKAN_HPP_DEFAULT_DISPATCHER.init(glfwGetInstanceProcAddress);
+    if (headless) {
+        loader.emplace();
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(loader->getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr"));
+    } else {
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(glfwGetInstanceProcAddress);
+    }
 
     vk::ApplicationInfo app_info{};
     app_info.setPApplicationName("Demo");
@@ -96,9 +145,12 @@ void Context::create_instance() {
     app_info.setEngineVersion(VK_MAKE_VERSION(1, 0, 0));
     app_info.setApiVersion(VK_API_VERSION_1_3);
 
-    uint32_t count = 0;
-    auto raw_extensions = glfwGetRequiredInstanceExtensions(&count);
-    auto extensions = std::vector<const char *>(raw_extensions, raw_extensions + count);
+    std::vector<const char *> extensions{};
+    if (!headless) {
+        uint32_t count = 0;
+        auto raw_extensions = glfwGetRequiredInstanceExtensions(&count);
+        extensions.assign(raw_extensions, raw_extensions + count);
+    }
 
 #ifndef NDEBUG
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -140,14 +192,113 @@ void Context::create_debug_utils() {
 #endif
 }
 
-void Context::select_physical_device() {
+auto Context::get_device_score(vk::PhysicalDevice device) const -> uint64_t {
+    // devices without the required features or queues can not run the renderer at all
+    auto properties = device.getProperties();
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+        return 0;
+    }
+    auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    if (!features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore) {
+        return 0;
+    }
+    auto families = device.getQueueFamilyProperties();
+    if (!has_queue_family(families, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute, {})) {
+        return 0;
+    }
+    if (!headless) {
+        auto extensions = device.enumerateDeviceExtensionProperties();
+        auto has_swapchain = std::any_of(extensions.begin(), extensions.end(), [](const vk::ExtensionProperties& extension) {
+            return std::string_view(extension.extensionName.data()) == VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+        });
+        auto has_present = false;
+        for (uint32_t i = 0; i < families.size() && !has_present; i++) {
+            has_present = glfwGetPhysicalDevicePresentationSupport(instance, device, i);
+        }
+        if (!has_swapchain || !has_present) {
+            return 0;
+        }
+    }
+
+    // the device type dominates, then device local memory in MiB, the queue topology only breaks ties,
+    // the memory field has 46 bits below the type which is more than any device has
+    auto memory_mib = std::min<uint64_t>(get_device_local_memory(device) >> 20, (uint64_t(1) << 46) - 1);
+    auto async_compute = has_queue_family(families, vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics);
+    auto dedicated_transfer = has_queue_family(families, vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
+
+    uint64_t score = get_device_type_score(properties.deviceType) << 48;
+    score |= memory_mib << 2;
+    score |= uint64_t(async_compute) << 1;
+    score |= uint64_t(dedicated_transfer);
+    return std::max<uint64_t>(score, 1);
+}
+
+void Context::select_physical_device(const std::string& preferred_device) {
     auto devices = instance.enumeratePhysicalDevices();
     if (devices.empty()) {
         throw std::runtime_error("No physical devices found");
     }
-    physical_device = devices.front();
 
-    spdlog::info("Selected device: {}", physical_device.getProperties().deviceName);
+    std::vector<uint64_t> scores(devices.size());
+    for (size_t i = 0; i < devices.size(); i++) {
+        scores[i] = get_device_score(devices[i]);
+
+        auto properties = devices[i].getProperties();
+        auto families = devices[i].getQueueFamilyProperties();
+        spdlog::info(
+            "Device {}: {} ({}), Vulkan {}.{}.{}, {} MiB device local, {} queue families{}{}, {}",
+            i,
+            properties.deviceName,
+            vk::to_string(properties.deviceType),
+            VK_API_VERSION_MAJOR(properties.apiVersion),
+            VK_API_VERSION_MINOR(properties.apiVersion),
+            VK_API_VERSION_PATCH(properties.apiVersion),
+            get_device_local_memory(devices[i]) >> 20,
+            families.size(),
+            has_queue_family(families, vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics) ? ", async compute" : "",
+            has_queue_family(families, vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute) ? ", dedicated transfer" : "",
+            scores[i] != 0 ? fmt::format("score {}", scores[i]) : "unsuitable"
+        );
+    }
+
+    // the highest score wins, ties keep the enumeration order so the choice is deterministic
+    auto selected = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (scores[i] != 0 && (selected == std::numeric_limits<size_t>::max() || scores[i] > scores[selected])) {
+            selected = i;
+        }
+    }
+
+    // an override selects a device by index or by a case insensitive part of its name
+    if (!preferred_device.empty()) {
+        auto found = std::numeric_limits<size_t>::max();
+        if (std::all_of(preferred_device.begin(), preferred_device.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            auto index = std::stoull(preferred_device);
+            found = index < devices.size() ? index : found;
+        } else {
+            auto name = to_lower(preferred_device);
+            for (size_t i = 0; i < devices.size() && found == std::numeric_limits<size_t>::max(); i++) {
+                if (to_lower(devices[i].getProperties().deviceName.data()).find(name) != std::string::npos) {
+                    found = i;
+                }
+            }
+        }
+
+        if (found == std::numeric_limits<size_t>::max()) {
+            spdlog::warn("Preferred device '{}' not found", preferred_device);
+        } else if (scores[found] == 0) {
+            spdlog::warn("Preferred device '{}' is not suitable", preferred_device);
+        } else {
+            selected = found;
+        }
+    }
+
+    if (selected == std::numeric_limits<size_t>::max()) {
+        throw std::runtime_error("No suitable physical device found");
+    }
+    physical_device = devices[selected];
+
+    spdlog::info("Selected device {}: {}", selected, physical_device.getProperties().deviceName);
 
     // get queue family indices
     auto queue_families = physical_device.getQueueFamilyProperties();
@@ -164,9 +315,12 @@ void Context::select_physical_device() {
         exit(1);
     }
 
-    // find a present queue family index
+    // find a present queue family index, nothing is presented without a window
     present_queue_family_index = std::numeric_limits<uint32_t>::max();
-    for (uint32_t i = 0; i < queue_families.size(); i++) {
+    if (headless) {
+        present_queue_family_index = graphics_queue_family_index;
+    }
+    for (uint32_t i = 0; i < queue_families.size() && present_queue_family_index == std::numeric_limits<uint32_t>::max(); i++) {
         auto present_support = glfwGetPhysicalDevicePresentationSupport(instance, physical_device, i);
         if (present_support) {
             present_queue_family_index = i;
@@ -178,18 +332,34 @@ void Context::select_physical_device() {
         exit(1);
     }
 
-    // find a compute queue family index
+    // find a compute queue family index, a family without graphics support runs asynchronously to the graphics queue
     compute_queue_family_index = std::numeric_limits<uint32_t>::max();
     for (uint32_t i = 0; i < queue_families.size(); i++) {
-        if (queue_families[i].queueFlags & vk::QueueFlagBits::eCompute) {
+        if ((queue_families[i].queueFlags & vk::QueueFlagBits::eCompute) && !(queue_families[i].queueFlags & vk::QueueFlagBits::eGraphics)) {
             compute_queue_family_index = i;
             break;
         }
     }
+    for (uint32_t i = 0; i < queue_families.size() && compute_queue_family_index == std::numeric_limits<uint32_t>::max(); i++) {
+        if (queue_families[i].queueFlags & vk::QueueFlagBits::eCompute) {
+            compute_queue_family_index = i;
+        }
+    }
     if (compute_queue_family_index == std::numeric_limits<uint32_t>::max()) {
         spdlog::error("No compute queue family index found");
         exit(1);
     }
+
+    // find a transfer only family, its DMA engines copy while the graphics queue renders, otherwise transfers run on the graphics queue
+    transfer_queue_family_index = graphics_queue_family_index;
+    for (uint32_t i = 0; i < queue_families.size(); i++) {
+        auto flags = queue_families[i].queueFlags;
+        if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+            transfer_queue_family_index = i;
+            break;
+        }
+    }
+    spdlog::info("Queue families: graphics {}, present {}, compute {}, transfer {}", graphics_queue_family_index, present_queue_family_index, compute_queue_family_index, transfer_queue_family_index);
 }
 
 void Context::create_logical_device() {
@@ -198,7 +368,8 @@ void Context::create_logical_device() {
     std::set<uint32_t> unique_queue_families = {
         graphics_queue_family_index,
         present_queue_family_index,
-        compute_queue_family_index
+        compute_queue_family_index,
+        transfer_queue_family_index
     };
 
     // create a vector of queue create info structures
@@ -213,7 +384,9 @@ void Context::create_logical_device() {
 
     // create a vector of extension names
     std::vector<const char*> extensions{};
-    extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!headless) {
+        extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     extensions.push_back(VK_KHR_BIND_MEMORY_2_EXTENSION_NAME);
     extensions.push_back(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME);
     extensions.push_back(VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME);
@@ -221,8 +394,49 @@ void Context::create_logical_device() {
     extensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
 #endif
 
+    // per-heap budget queries are optional, fall back to VMA's own estimation
+    memory_budget_supported = false;
+    for (auto& properties : physical_device.enumerateDeviceExtensionProperties()) {
+        if (std::string_view(properties.extensionName.data()) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) {
+            memory_budget_supported = true;
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            break;
+        }
+    }
+
+    // frames and queues are synchronized with timeline semaphores, core since Vulkan 1.2
+    if (physical_device.getProperties().apiVersion < VK_API_VERSION_1_2) {
+        throw std::runtime_error("Vulkan 1.2 is required");
+    }
+    auto supported_features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    if (!supported_features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore) {
+        throw std::runtime_error("Timeline semaphores are not supported");
+    }
+
+    // GPU driven draws read their count from a buffer when supported, otherwise the full indirect buffer is drawn
+    multi_draw_indirect_supported = supported_features.get<vk::PhysicalDeviceFeatures2>().features.multiDrawIndirect;
+    draw_indirect_count_supported = supported_features.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount;
+    // indirect commands may only use a non-zero first instance with this feature
+    draw_indirect_first_instance_supported = supported_features.get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance;
+    spdlog::info(
+        "Multi draw indirect: {}, draw indirect count: {}, draw indirect first instance: {}",
+        multi_draw_indirect_supported,
+        draw_indirect_count_supported,
+        draw_indirect_first_instance_supported
+    );
+
+    vk::PhysicalDeviceVulkan12Features vulkan12_features{};
+    vulkan12_features.setTimelineSemaphore(true);
+    vulkan12_features.setDrawIndirectCount(draw_indirect_count_supported);
+
+    vk::PhysicalDeviceFeatures2 features{};
+    features.setPNext(&vulkan12_features);
+    features.features.setMultiDrawIndirect(multi_draw_indirect_supported);
+    features.features.setDrawIndirectFirstInstance(draw_indirect_first_instance_supported);
+
     // create a logical device create info structure
     vk::DeviceCreateInfo device_create_info{};
+    device_create_info.setPNext(&features);
     device_create_info.setQueueCreateInfos(queue_create_infos);
     device_create_info.setPEnabledExtensionNames(extensions);
 
@@ -237,6 +451,8 @@ void Context::create_logical_device() {
     present_queue = device.getQueue(present_queue_family_index, 0);
     // get the compute queue
     compute_queue = device.getQueue(compute_queue_family_index, 0);
+    // get the transfer queue
+    transfer_queue = device.getQueue(transfer_queue_family_index, 0);
 }
 
 void Context::create_memory_allocator() {
@@ -288,6 +504,11 @@ void Context::create_memory_allocator() {
     allocator_create_info.pVulkanFunctions = &functions;
     allocator_create_info.instance = instance;
     allocator_create_info.vulkanApiVersion = VK_API_VERSION_1_2;
+    if (memory_budget_supported) {
+        allocator_create_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
 
     vmaCreateAllocator(&allocator_create_info, &allocator);
+
+    spdlog::info("Memory budget: {}", memory_budget_supported ? "VK_EXT_memory_budget" : "estimated");
 }
\ No newline at end of file
@@ -2,9 +2,12 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <string>
+#include <optional>
 #include "vk_mem_alloc.h"
 #include <vulkan/vulkan.hpp>
 
+#include "MemoryStats.hpp"
 #include "LoopEngine/Core/Singleton.hpp"
 
 namespace LoopEngine::Graphics {
@@ -17,19 +20,33 @@ namespace LoopEngine::Graphics {
         uint32_t graphics_queue_family_index{};
         uint32_t present_queue_family_index{};
         uint32_t compute_queue_family_index{};
+        uint32_t transfer_queue_family_index{};
 
         vk::Queue graphics_queue{};
         vk::Queue present_queue{};
         vk::Queue compute_queue{};
+        vk::Queue transfer_queue{};
 
         VmaAllocator allocator{};
         vk::Format depth_format{};
 
-        void initialize();
+        bool memory_budget_supported = false;
+        bool multi_draw_indirect_supported = false;
+        bool draw_indirect_count_supported = false;
+        bool draw_indirect_first_instance_supported = false;
+        MemoryStats memory_stats{};
+
+        // without a window the loader is opened directly and no presentation support is required
+        bool headless = false;
+        std::optional<vk::DynamicLoader> loader{};
+
+        // the preferred device is an index or a part of the device name, the best scored device is used otherwise
+        void initialize(bool headless = false, const std::string& preferred_device = {});
         void terminate();
         void create_instance();
         void create_debug_utils();
-        void select_physical_device();
+        void select_physical_device(const std::string& preferred_device);
+        [[nodiscard]] auto get_device_score(vk::PhysicalDevice device) const -> uint64_t;
         void create_logical_device();
         void create_memory_allocator();
     };
@@ -0,0 +1,260 @@
+#include "DepthPyramid.hpp"
+#include "Context.hpp"
+#include "Graphics.hpp"
+#include "Material.hpp"
+#include "MemoryStats.hpp"
+#include "LoopEngine/Camera/CameraSystem.hpp"
+
+#include <bit>
+#include <array>
+
+using LoopEngine::Camera::get_default_camera;
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::Graphics;
+using LoopEngine::Graphics::RenderGraph;
+using LoopEngine::Graphics::DepthPyramid;
+using LoopEngine::Graphics::RenderGraphQueue;
+using LoopEngine::Graphics::RenderGraphBuilder;
+using LoopEngine::Graphics::RenderGraphResource;
+using LoopEngine::Graphics::get_module_from_assets;
+
+static constexpr uint32_t workgroup_size = 8;
+
+DepthPyramid::DepthPyramid(Context& context) : context(context) {}
+
+void DepthPyramid::initialize() {
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].setBinding(0);
+    bindings[0].setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+    bindings[0].setDescriptorCount(1);
+    bindings[0].setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    bindings[1].setBinding(1);
+    bindings[1].setDescriptorType(vk::DescriptorType::eStorageImage);
+    bindings[1].setDescriptorCount(1);
+    bindings[1].setStageFlags(vk::ShaderStageFlagBits::eCompute);
+
+    vk::DescriptorSetLayoutCreateInfo set_layout_create_info{};
+    set_layout_create_info.setBindings(bindings);
+    descriptor_set_layout = context.device.createDescriptorSetLayout(set_layout_create_info);
+
+    vk::PushConstantRange push_constant_range{};
+    push_constant_range.setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    push_constant_range.setOffset(0);
+    push_constant_range.setSize(sizeof(LevelConstants));
+
+    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.setSetLayouts(descriptor_set_layout);
+    pipeline_layout_create_info.setPushConstantRanges(push_constant_range);
+    pipeline_layout = context.device.createPipelineLayout(pipeline_layout_create_info);
+
+    auto module = get_module_from_assets("engine/shaders/depth_pyramid.comp");
+    if (!module) {
+        throw std::runtime_error("Failed to load the depth pyramid shader");
+    }
+
+    vk::PipelineShaderStageCreateInfo stage_create_info{};
+    stage_create_info.setStage(vk::ShaderStageFlagBits::eCompute);
+    stage_create_info.setModule(module);
+    stage_create_info.setPName("main");
+
+    vk::ComputePipelineCreateInfo pipeline_create_info{};
+    pipeline_create_info.setStage(stage_create_info);
+    pipeline_create_info.setLayout(pipeline_layout);
+    check(context.device.createComputePipelines(nullptr, 1, &pipeline_create_info, nullptr, &pipeline));
+
+    context.device.destroyShaderModule(module);
+
+    // texels are fetched by index, the sampler only has to be valid
+    vk::SamplerCreateInfo sampler_create_info{};
+    sampler_create_info.setMagFilter(vk::Filter::eNearest);
+    sampler_create_info.setMinFilter(vk::Filter::eNearest);
+    sampler_create_info.setMipmapMode(vk::SamplerMipmapMode::eNearest);
+    sampler_create_info.setAddressModeU(vk::SamplerAddressMode::eClampToEdge);
+    sampler_create_info.setAddressModeV(vk::SamplerAddressMode::eClampToEdge);
+    sampler_create_info.setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+    sampler_create_info.setMaxLod(VK_LOD_CLAMP_NONE);
+    sampler = context.device.createSampler(sampler_create_info);
+}
+
+void DepthPyramid::terminate() {
+    release_handler = {};
+    release_image();
+
+    context.device.destroySampler(sampler);
+    context.device.destroyPipeline(pipeline);
+    context.device.destroyPipelineLayout(pipeline_layout);
+    context.device.destroyDescriptorSetLayout(descriptor_set_layout);
+}
+
+void DepthPyramid::resize(vk::Extent2D depth_extent) {
+    release_image();
+
+    this->depth_extent = depth_extent;
+    render_extent = depth_extent;
+    source_extent = depth_extent;
+    extent.width = std::bit_ceil(std::max((depth_extent.width + 1) / 2, 1u));
+    extent.height = std::bit_ceil(std::max((depth_extent.height + 1) / 2, 1u));
+    mip_levels = static_cast<uint32_t>(std::bit_width(std::max(extent.width, extent.height)));
+
+    vk::ImageCreateInfo image_create_info{};
+    image_create_info.setImageType(vk::ImageType::e2D);
+    image_create_info.setFormat(vk::Format::eR32Sfloat);
+    image_create_info.setExtent({extent.width, extent.height, 1});
+    image_create_info.setMipLevels(mip_levels);
+    image_create_info.setArrayLayers(1);
+    image_create_info.setSamples(vk::SampleCountFlagBits::e1);
+    image_create_info.setTiling(vk::ImageTiling::eOptimal);
+    image_create_info.setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst);
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    vmaCreateImage(context.allocator, reinterpret_cast<const VkImageCreateInfo *>(&image_create_info), &alloc_info, reinterpret_cast<VkImage *>(&image), &allocation, nullptr);
+    track_allocation(MemoryCategory::Depth, allocation);
+
+    vk::ImageViewCreateInfo view_create_info{};
+    view_create_info.setImage(image);
+    view_create_info.setViewType(vk::ImageViewType::e2D);
+    view_create_info.setFormat(vk::Format::eR32Sfloat);
+    view_create_info.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, mip_levels, 0, 1});
+    view = context.device.createImageView(view_create_info);
+
+    mip_views.resize(mip_levels);
+    for (uint32_t level = 0; level < mip_levels; level++) {
+        view_create_info.setSubresourceRange({vk::ImageAspectFlagBits::eColor, level, 1, 0, 1});
+        mip_views[level] = context.device.createImageView(view_create_info);
+    }
+
+    cleared = false;
+    built = false;
+}
+
+void DepthPyramid::set_release_handler(RenderGraphRelease handler) {
+    release_handler = std::move(handler);
+}
+
+void DepthPyramid::prepare(vk::CommandBuffer cmd) {
+    if (cleared || !image) {
+        return;
+    }
+
+    vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+
+    vk::ImageMemoryBarrier barrier{};
+    barrier.setImage(image);
+    barrier.setSubresourceRange(range);
+    barrier.setOldLayout(vk::ImageLayout::eUndefined);
+    barrier.setNewLayout(vk::ImageLayout::eGeneral);
+    barrier.setSrcAccessMask({});
+    barrier.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+    barrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+    barrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags{}, nullptr, nullptr, barrier);
+
+    // the far plane occludes nothing
+    cmd.clearColorImage(image, vk::ImageLayout::eGeneral, vk::ClearColorValue{}.setFloat32({1.0f, 1.0f, 1.0f, 1.0f}), range);
+
+    barrier.setOldLayout(vk::ImageLayout::eGeneral);
+    barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+    barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags{}, nullptr, nullptr, barrier);
+
+    view_projection = glm::mat4(1.0f);
+    camera_position = glm::vec3(0.0f);
+    cleared = true;
+}
+
+void DepthPyramid::add_pass(RenderGraph& graph, RenderGraphResource depth, RenderGraphResource pyramid) {
+    built = false;
+
+    graph.add_pass("depth_pyramid", RenderGraphQueue::Graphics, [depth, pyramid](RenderGraphBuilder& builder) {
+        builder.read(depth, RenderGraphAccesses::compute_sampled);
+        // the graph waits for the reads of the pyramid in this frame and hands it over to the next one
+        builder.write(pyramid, RenderGraphAccesses::compute_storage_write);
+    }, [this, depth](vk::CommandBuffer cmd, RenderGraph& graph) {
+        build(cmd, graph.get_image_view(depth));
+    });
+}
+
+void DepthPyramid::build(vk::CommandBuffer cmd, vk::ImageView depth_view) {
+    auto camera = get_default_camera();
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+
+    auto source_view = depth_view;
+    auto source_layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    // texels past the rendered part are never looked up, they only repeat its edge
+    auto rendered = vk::Extent2D{std::min(render_extent.width, depth_extent.width), std::min(render_extent.height, depth_extent.height)};
+    auto source_size = glm::ivec2(rendered.width, rendered.height);
+    for (uint32_t level = 0; level < mip_levels; level++) {
+        auto destination_size = glm::ivec2(std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u));
+
+        vk::DescriptorImageInfo source_info{sampler, source_view, source_layout};
+        vk::DescriptorImageInfo destination_info{nullptr, mip_views[level], vk::ImageLayout::eGeneral};
+
+        auto descriptor_set = Graphics::get_instance()->allocate_transient_descriptor_set(descriptor_set_layout);
+
+        std::array<vk::WriteDescriptorSet, 2> writes{};
+        writes[0].setDstSet(descriptor_set);
+        writes[0].setDstBinding(0);
+        writes[0].setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+        writes[0].setImageInfo(source_info);
+        writes[1].setDstSet(descriptor_set);
+        writes[1].setDstBinding(1);
+        writes[1].setDescriptorType(vk::DescriptorType::eStorageImage);
+        writes[1].setImageInfo(destination_info);
+        context.device.updateDescriptorSets(writes, nullptr);
+
+        LevelConstants constants{source_size, destination_size};
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeline_layout, 0, descriptor_set, {});
+        cmd.pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(LevelConstants), &constants);
+        cmd.dispatch((destination_size.x + workgroup_size - 1) / workgroup_size, (destination_size.y + workgroup_size - 1) / workgroup_size, 1);
+
+        // the level is read by the next one
+        vk::ImageMemoryBarrier barrier{};
+        barrier.setImage(image);
+        barrier.setSubresourceRange({vk::ImageAspectFlagBits::eColor, level, 1, 0, 1});
+        barrier.setOldLayout(vk::ImageLayout::eGeneral);
+        barrier.setNewLayout(vk::ImageLayout::eGeneral);
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
+        barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+        barrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+        barrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags{}, nullptr, nullptr, barrier);
+
+        source_view = mip_views[level];
+        source_layout = vk::ImageLayout::eGeneral;
+        source_size = destination_size;
+    }
+
+    view_projection = camera->get_projection_matrix() * camera->get_view_matrix();
+    camera_position = camera->get_position();
+    source_extent = rendered;
+    built = true;
+}
+
+void DepthPyramid::release_image() {
+    if (!image) {
+        return;
+    }
+
+    auto release = [&context = context, image = image, allocation = allocation, view = view, mip_views = std::move(mip_views)] {
+        for (auto mip_view : mip_views) {
+            context.device.destroyImageView(mip_view);
+        }
+        context.device.destroyImageView(view);
+
+        untrack_allocation(MemoryCategory::Depth, allocation);
+        vmaDestroyImage(context.allocator, image, allocation);
+    };
+    if (release_handler) {
+        release_handler(std::move(release));
+    } else {
+        release();
+    }
+
+    image = nullptr;
+    allocation = nullptr;
+    view = nullptr;
+    mip_views.clear();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "RenderGraph.hpp"
+
+#include "glm/glm.hpp"
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+
+    // Hierarchical depth buffer built from the depth attachment at the end of the frame. Level 0 has half the
+    // resolution of the depth rounded up to a power of two, every texel keeps the farthest depth of the area it
+    // covers, so a bounding rectangle tested against at most 2x2 texels of the matching level is conservative.
+    // The pyramid stays in the general layout and is imported into the frame graph, passes of the next frame read
+    // it together with the view projection it was rendered with. Until the first build it is cleared to the far
+    // plane and occludes nothing.
+    struct DepthPyramid {
+        explicit DepthPyramid(Context& context);
+
+        void initialize();
+        void terminate();
+
+        // recreates the pyramid for a depth attachment of the given size
+        void resize(vk::Extent2D depth_extent);
+
+        // called with a function that destroys the images of a previous size
+        void set_release_handler(RenderGraphRelease handler);
+
+        // clears a newly created pyramid, must be submitted before any pass that reads it
+        void prepare(vk::CommandBuffer cmd);
+
+        // adds a graphics pass that builds the pyramid resource from the depth written by the previous passes
+        void add_pass(RenderGraph& graph, RenderGraphResource depth, RenderGraphResource pyramid);
+
+        // the part of the depth attachment the scene is rendered to in the current frame, the whole attachment by default
+        void set_render_extent(vk::Extent2D render_extent) {
+            this->render_extent = render_extent;
+        }
+
+        [[nodiscard]] auto get_image() const -> vk::Image {
+            return image;
+        }
+
+        [[nodiscard]] auto get_view() const -> vk::ImageView {
+            return view;
+        }
+
+        [[nodiscard]] auto get_sampler() const -> vk::Sampler {
+            return sampler;
+        }
+
+        [[nodiscard]] auto get_depth_extent() const -> vk::Extent2D {
+            return depth_extent;
+        }
+
+        // the part of the depth the current contents were built from
+        [[nodiscard]] auto get_source_extent() const -> vk::Extent2D {
+            return source_extent;
+        }
+
+        [[nodiscard]] auto get_extent() const -> vk::Extent2D {
+            return extent;
+        }
+
+        [[nodiscard]] auto get_mip_levels() const -> uint32_t {
+            return mip_levels;
+        }
+
+        // the frame graph does not acquire contents built by a previous graph, they are only valid once
+        // the pass of the current graph has been recorded
+        [[nodiscard]] auto is_built() const -> bool {
+            return built;
+        }
+
+        // the camera the current contents were rendered with
+        [[nodiscard]] auto get_view_projection() const -> const glm::mat4& {
+            return view_projection;
+        }
+
+        [[nodiscard]] auto get_camera_position() const -> const glm::vec3& {
+            return camera_position;
+        }
+
+    private:
+        struct LevelConstants {
+            glm::ivec2 source_size;
+            glm::ivec2 destination_size;
+        };
+
+        void build(vk::CommandBuffer cmd, vk::ImageView depth_view);
+        void release_image();
+
+        Context& context;
+        RenderGraphRelease release_handler{};
+
+        vk::DescriptorSetLayout descriptor_set_layout{};
+        vk::PipelineLayout pipeline_layout{};
+        vk::Pipeline pipeline{};
+        vk::Sampler sampler{};
+
+        vk::Image image{};
+        VmaAllocation allocation{};
+        vk::ImageView view{};
+        std::vector<vk::ImageView> mip_views{};
+        vk::Extent2D depth_extent{};
+        vk::Extent2D render_extent{};
+        vk::Extent2D source_extent{};
+        vk::Extent2D extent{};
+        uint32_t mip_levels = 0;
+        bool cleared = false;
+        bool built = false;
+
+        glm::mat4 view_projection{1.0f};
+        glm::vec3 camera_position{0.0f};
+    };
+}
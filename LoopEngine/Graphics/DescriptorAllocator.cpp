@@ -0,0 +1,106 @@
+#include "DescriptorAllocator.hpp"
+#include "Context.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <array>
+#include <utility>
+
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::DescriptorAllocator;
+
+DescriptorAllocator::DescriptorAllocator(Context& context) : context(context) {}
+
+void DescriptorAllocator::initialize(size_t frame_count) {
+    frames.resize(frame_count);
+    for (auto& frame : frames) {
+        frame.pools.push_back(create_pool(initial_sets_per_pool));
+    }
+}
+
+void DescriptorAllocator::terminate() {
+    for (auto& frame : frames) {
+        for (auto pool : frame.pools) {
+            context.device.destroyDescriptorPool(pool);
+        }
+    }
+    frames.clear();
+}
+
+void DescriptorAllocator::reset_frame(size_t frame) {
+    auto& frame_pools = frames[frame];
+    for (size_t i = 0; i <= frame_pools.current && i < frame_pools.pools.size(); i++) {
+        context.device.resetDescriptorPool(frame_pools.pools[i]);
+    }
+    frame_pools.current = 0;
+    frame_pools.current_sets = 0;
+}
+
+auto DescriptorAllocator::allocate(size_t frame, vk::DescriptorSetLayout layout) -> vk::DescriptorSet {
+    auto& frame_pools = frames[frame];
+
+    vk::DescriptorSetAllocateInfo alloc_info{};
+    alloc_info.setDescriptorSetCount(1);
+    alloc_info.setPSetLayouts(&layout);
+
+    while (true) {
+        alloc_info.setDescriptorPool(frame_pools.pools[frame_pools.current]);
+
+        vk::DescriptorSet set{};
+        auto result = context.device.allocateDescriptorSets(&alloc_info, &set);
+        if (result == vk::Result::eSuccess) {
+            frame_pools.current_sets += 1;
+            return set;
+        }
+        // a layout that does not fit an empty pool never fits the next one either
+        if ((result != vk::Result::eErrorOutOfPoolMemory && result != vk::Result::eErrorFragmentedPool) || frame_pools.current_sets == 0) {
+            check(result);
+        }
+
+        // chain the next pool, pools kept from earlier frames are reused before new ones are created
+        frame_pools.current += 1;
+        frame_pools.current_sets = 0;
+        if (frame_pools.current == frame_pools.pools.size()) {
+            auto max_sets = std::min(initial_sets_per_pool << std::min<size_t>(frame_pools.pools.size(), 6), max_sets_per_pool);
+            frame_pools.pools.push_back(create_pool(max_sets));
+            spdlog::debug("Descriptor pool {} of frame {} created with {} sets", frame_pools.pools.size(), frame, max_sets);
+        }
+    }
+}
+
+auto DescriptorAllocator::get_pool_count() const -> size_t {
+    size_t count = 0;
+    for (auto& frame : frames) {
+        count += frame.pools.size();
+    }
+    return count;
+}
+
+auto DescriptorAllocator::create_pool(uint32_t max_sets) -> vk::DescriptorPool {
+    // descriptor counts per set, sized for the usual material and per draw layouts, every core type is
+    // present so that any layout fits an empty pool
+    static constexpr std::array<std::pair<vk::DescriptorType, uint32_t>, 11> ratios{{
+        {vk::DescriptorType::eUniformBuffer, 2},
+        {vk::DescriptorType::eUniformBufferDynamic, 1},
+        {vk::DescriptorType::eStorageBuffer, 2},
+        {vk::DescriptorType::eStorageBufferDynamic, 1},
+        {vk::DescriptorType::eCombinedImageSampler, 4},
+        {vk::DescriptorType::eSampledImage, 1},
+        {vk::DescriptorType::eStorageImage, 1},
+        {vk::DescriptorType::eSampler, 1},
+        {vk::DescriptorType::eUniformTexelBuffer, 1},
+        {vk::DescriptorType::eStorageTexelBuffer, 1},
+        {vk::DescriptorType::eInputAttachment, 1}
+    }};
+
+    std::array<vk::DescriptorPoolSize, ratios.size()> pool_sizes{};
+    for (size_t i = 0; i < ratios.size(); i++) {
+        pool_sizes[i].setType(ratios[i].first);
+        pool_sizes[i].setDescriptorCount(ratios[i].second * max_sets);
+    }
+
+    vk::DescriptorPoolCreateInfo pool_create_info{};
+    pool_create_info.setMaxSets(max_sets);
+    pool_create_info.setPoolSizes(pool_sizes);
+    return context.device.createDescriptorPool(pool_create_info);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+
+    // Allocates transient descriptor sets that live for a single frame. Every frame in flight owns a chain of pools,
+    // a new pool is appended when the current one is exhausted and the whole chain is reset once the frame has
+    // finished, so allocations never free individual sets and stay a bump in the pool. The allocator is not thread-safe,
+    // sets are allocated on the main thread only.
+    struct DescriptorAllocator {
+        explicit DescriptorAllocator(Context& context);
+
+        void initialize(size_t frame_count);
+        void terminate();
+
+        // must only be called once the GPU has finished the frame
+        void reset_frame(size_t frame);
+
+        // throws if the layout does not fit an empty pool, for example when it needs more descriptors of a type than the pool holds
+        auto allocate(size_t frame, vk::DescriptorSetLayout layout) -> vk::DescriptorSet;
+
+        [[nodiscard]] auto get_pool_count() const -> size_t;
+
+    private:
+        static constexpr uint32_t initial_sets_per_pool = 64;
+        static constexpr uint32_t max_sets_per_pool = 4096;
+
+        struct FramePools {
+            std::vector<vk::DescriptorPool> pools{};
+            size_t current = 0;
+            // sets allocated from the current pool since it was last reset
+            uint32_t current_sets = 0;
+        };
+
+        auto create_pool(uint32_t max_sets) -> vk::DescriptorPool;
+
+        Context& context;
+        std::vector<FramePools> frames{};
+    };
+}
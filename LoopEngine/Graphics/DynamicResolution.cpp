@@ -0,0 +1,72 @@
+#include "DynamicResolution.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using LoopEngine::Graphics::DynamicResolution;
+
+// samples averaged after a change before the scale moves again
+static constexpr size_t settle_frames = 8;
+// weight of a new sample in the moving average
+static constexpr float smoothing = 0.25f;
+// times between the target and this fraction of it keep the current scale
+static constexpr float headroom = 0.15f;
+// largest change of the scale in a single step, larger jumps are visible
+static constexpr float max_step = 0.1f;
+
+void DynamicResolution::set_enabled(bool enabled) {
+    this->enabled = enabled;
+    reset(max_scale);
+}
+
+void DynamicResolution::set_target_time(float milliseconds) {
+    target_time = std::max(milliseconds, 0.1f);
+}
+
+void DynamicResolution::set_scale_range(float min_scale, float max_scale) {
+    this->max_scale = std::clamp(max_scale, 0.1f, 1.0f);
+    this->min_scale = std::clamp(min_scale, 0.1f, this->max_scale);
+    reset(std::clamp(scale, this->min_scale, this->max_scale));
+}
+
+auto DynamicResolution::update(float gpu_time, size_t frames_in_flight) -> float {
+    if (!enabled || gpu_time <= 0.0f) {
+        return scale;
+    }
+
+    // frames recorded before the change was made still report the old scale
+    frames_since_change += 1;
+    if (frames_since_change <= frames_in_flight) {
+        return scale;
+    }
+
+    average_time = average_time > 0.0f ? average_time + (gpu_time - average_time) * smoothing : gpu_time;
+    if (frames_since_change < frames_in_flight + settle_frames) {
+        return scale;
+    }
+    if (average_time <= target_time && average_time >= target_time * (1.0f - headroom)) {
+        return scale;
+    }
+
+    // aims at the middle of the band, so the next measurement does not leave it right away
+    auto goal = target_time * (1.0f - headroom * 0.5f);
+    auto desired = scale * std::sqrt(goal / average_time);
+    desired = std::clamp(desired, scale - max_step, scale + max_step);
+    desired = std::clamp(desired, min_scale, max_scale);
+    if (desired != scale) {
+        reset(desired);
+    }
+    return scale;
+}
+
+auto DynamicResolution::get_render_extent(vk::Extent2D extent) const -> vk::Extent2D {
+    auto width = static_cast<uint32_t>(std::lround(static_cast<float>(extent.width) * scale));
+    auto height = static_cast<uint32_t>(std::lround(static_cast<float>(extent.height) * scale));
+    return {std::clamp(width, 1u, std::max(extent.width, 1u)), std::clamp(height, 1u, std::max(extent.height, 1u))};
+}
+
+void DynamicResolution::reset(float new_scale) {
+    scale = new_scale;
+    average_time = 0.0f;
+    frames_since_change = 0;
+}
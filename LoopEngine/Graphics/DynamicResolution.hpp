@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+namespace LoopEngine::Graphics {
+    // Picks the fraction of the surface the scene is rendered at from the measured GPU frame time. The GPU time
+    // is roughly proportional to the number of pixels, so the scale moves towards the square root of the ratio
+    // between the target and the measured time. Timings of a new scale arrive a few frames late, samples of the
+    // frames still in flight are skipped and the scale only changes when the average leaves the target band.
+    struct DynamicResolution {
+        void set_enabled(bool enabled);
+        [[nodiscard]] auto is_enabled() const -> bool {
+            return enabled;
+        }
+
+        // in milliseconds, the scale is lowered once the GPU takes longer than this
+        void set_target_time(float milliseconds);
+        [[nodiscard]] auto get_target_time() const -> float {
+            return target_time;
+        }
+
+        // both are clamped to (0, 1]
+        void set_scale_range(float min_scale, float max_scale);
+        [[nodiscard]] auto get_min_scale() const -> float {
+            return min_scale;
+        }
+        [[nodiscard]] auto get_max_scale() const -> float {
+            return max_scale;
+        }
+
+        // takes the GPU time of a finished frame and the number of frames recorded after it, returns the new scale
+        auto update(float gpu_time, size_t frames_in_flight) -> float;
+
+        [[nodiscard]] auto get_scale() const -> float {
+            return scale;
+        }
+
+        // the part of the extent the scene is rendered to, never empty
+        [[nodiscard]] auto get_render_extent(vk::Extent2D extent) const -> vk::Extent2D;
+
+    private:
+        void reset(float new_scale);
+
+        bool enabled = true;
+        float target_time = 14.0f;
+        float min_scale = 0.5f;
+        float max_scale = 1.0f;
+
+        float scale = 1.0f;
+        float average_time = 0.0f;
+        size_t frames_since_change = 0;
+    };
+}
@@ -0,0 +1,168 @@
+#include "FramePacing.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <thread>
+#include <utility>
+#include <algorithm>
+
+using LoopEngine::Graphics::FramePacing;
+using LoopEngine::Graphics::LatencyProfile;
+
+using as_milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+// weight of the newest sample in the running averages
+static constexpr auto smoothing = 0.1f;
+// number of completed frames the maximum latency is taken over
+static constexpr auto max_latency_window = 120;
+
+void FramePacing::initialize(size_t capacity) {
+    frame_capacity = std::max<size_t>(capacity, 1);
+    frames_in_flight = frame_capacity;
+}
+
+void FramePacing::set_profile(LatencyProfile new_profile) {
+    if (profile != new_profile) {
+        profile = new_profile;
+        swapchain_changed = true;
+    }
+
+    switch (profile) {
+        case LatencyProfile::Throughput:
+            set_frames_in_flight(frame_capacity);
+            break;
+        case LatencyProfile::Balanced:
+            set_frames_in_flight(2);
+            break;
+        case LatencyProfile::LowLatency:
+            set_frames_in_flight(1);
+            break;
+    }
+    spdlog::info("Latency profile: {}, {} frames in flight", get_latency_profile_name(profile), frames_in_flight);
+}
+
+void FramePacing::set_frames_in_flight(size_t count) {
+    auto new_frames_in_flight = std::clamp<size_t>(count, 1, frame_capacity);
+    // the fifo image count follows the number of frames in flight
+    if (frames_in_flight != new_frames_in_flight) {
+        frames_in_flight = new_frames_in_flight;
+        swapchain_changed = true;
+    }
+}
+
+void FramePacing::set_frame_rate_limit(float frames_per_second) {
+    frame_rate_limit = std::max(frames_per_second, 0.0f);
+    next_frame_time = Clock::now();
+}
+
+auto FramePacing::select_present_mode(const std::vector<vk::PresentModeKHR>& available) const -> vk::PresentModeKHR {
+    auto is_available = [&](vk::PresentModeKHR mode) {
+        return std::find(available.begin(), available.end(), mode) != available.end();
+    };
+
+    switch (profile) {
+        case LatencyProfile::Throughput:
+            break;
+        case LatencyProfile::Balanced:
+            if (is_available(vk::PresentModeKHR::eMailbox)) {
+                return vk::PresentModeKHR::eMailbox;
+            }
+            break;
+        case LatencyProfile::LowLatency:
+            if (is_available(vk::PresentModeKHR::eMailbox)) {
+                return vk::PresentModeKHR::eMailbox;
+            }
+            if (is_available(vk::PresentModeKHR::eImmediate)) {
+                return vk::PresentModeKHR::eImmediate;
+            }
+            break;
+    }
+    // fifo is the only mode every implementation has to support
+    return vk::PresentModeKHR::eFifo;
+}
+
+auto FramePacing::select_image_count(vk::PresentModeKHR present_mode, const vk::SurfaceCapabilitiesKHR& capabilities) const -> uint32_t {
+    // mailbox needs a spare image to replace, fifo queues one image per frame in flight on top of the displayed one
+    auto count = static_cast<uint32_t>(present_mode == vk::PresentModeKHR::eMailbox ? 3 : frames_in_flight + 1);
+    count = std::max(count, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0) {
+        count = std::min(count, capabilities.maxImageCount);
+    }
+    return count;
+}
+
+auto FramePacing::consume_swapchain_change() -> bool {
+    return std::exchange(swapchain_changed, false);
+}
+
+void FramePacing::limit_frame_rate() {
+    if (frame_rate_limit <= 0.0f) {
+        return;
+    }
+
+    auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frame_rate_limit));
+    auto now = Clock::now();
+    if (next_frame_time > now) {
+        // sleep is too coarse to hit the deadline, spin for the last millisecond
+        static constexpr auto spin_time = std::chrono::milliseconds(1);
+        if (next_frame_time - now > spin_time) {
+            std::this_thread::sleep_until(next_frame_time - spin_time);
+        }
+        while (Clock::now() < next_frame_time) {
+            std::this_thread::yield();
+        }
+    }
+    // do not try to catch up after a long frame, that would only produce a burst of frames
+    next_frame_time = std::max(next_frame_time, now) + period;
+}
+
+void FramePacing::on_input_sampled(uint64_t frame_number) {
+    auto now = Clock::now();
+    if (last_input_time != Clock::time_point{}) {
+        auto frame_time = as_milliseconds(now - last_input_time).count();
+        stats.frame_time += (frame_time - stats.frame_time) * smoothing;
+    }
+    last_input_time = now;
+
+    auto& times = frame_times[frame_number % frame_times.size()];
+    times.frame_number = frame_number;
+    times.input = now;
+}
+
+void FramePacing::on_frame_submitted(uint64_t frame_number) {
+    auto& times = frame_times[frame_number % frame_times.size()];
+    if (times.frame_number != frame_number) {
+        return;
+    }
+    times.submit = Clock::now();
+
+    auto latency = as_milliseconds(times.submit - times.input).count();
+    stats.submit_latency += (latency - stats.submit_latency) * smoothing;
+}
+
+void FramePacing::on_frame_completed(uint64_t frame_number) {
+    auto& times = frame_times[frame_number % frame_times.size()];
+    if (times.frame_number != frame_number) {
+        return;
+    }
+
+    // completion is observed when the frame timeline is checked, so this is an upper bound
+    auto latency = as_milliseconds(Clock::now() - times.input).count();
+    stats.gpu_latency += (latency - stats.gpu_latency) * smoothing;
+
+    window_max_gpu_latency = std::max(window_max_gpu_latency, latency);
+    if (++window_frame_count == max_latency_window) {
+        stats.max_gpu_latency = window_max_gpu_latency;
+        window_max_gpu_latency = 0.0f;
+        window_frame_count = 0;
+    }
+}
+
+auto LoopEngine::Graphics::get_latency_profile_name(LatencyProfile profile) -> const char* {
+    switch (profile) {
+        case LatencyProfile::Throughput: return "Throughput";
+        case LatencyProfile::Balanced: return "Balanced";
+        case LatencyProfile::LowLatency: return "LowLatency";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <vector>
+
+namespace LoopEngine::Graphics {
+    enum class LatencyProfile {
+        // fifo present, every frame in flight is used to keep the GPU busy
+        Throughput,
+        // mailbox present when available, two frames in flight
+        Balanced,
+        // mailbox or immediate present, the CPU waits for the previous frame before sampling input
+        LowLatency
+    };
+
+    // latencies are measured from the moment input is sampled, in milliseconds
+    struct FramePacingStats {
+        float frame_time = 0.0f;
+        float submit_latency = 0.0f;
+        float gpu_latency = 0.0f;
+        float max_gpu_latency = 0.0f;
+    };
+
+    // Chooses the present mode and the number of frames in flight for a latency profile, limits
+    // the frame rate and measures the time from input sampling to submission and GPU completion.
+    struct FramePacing {
+        using Clock = std::chrono::steady_clock;
+
+        void initialize(size_t frame_capacity);
+
+        void set_profile(LatencyProfile profile);
+        [[nodiscard]] auto get_profile() const -> LatencyProfile {
+            return profile;
+        }
+
+        // the number of frames in flight is clamped to the number of frames the renderer allocated
+        void set_frames_in_flight(size_t count);
+        [[nodiscard]] auto get_frames_in_flight() const -> size_t {
+            return frames_in_flight;
+        }
+        [[nodiscard]] auto get_frame_capacity() const -> size_t {
+            return frame_capacity;
+        }
+
+        // zero disables the limiter
+        void set_frame_rate_limit(float frames_per_second);
+        [[nodiscard]] auto get_frame_rate_limit() const -> float {
+            return frame_rate_limit;
+        }
+
+        [[nodiscard]] auto select_present_mode(const std::vector<vk::PresentModeKHR>& available) const -> vk::PresentModeKHR;
+        [[nodiscard]] auto select_image_count(vk::PresentModeKHR present_mode, const vk::SurfaceCapabilitiesKHR& capabilities) const -> uint32_t;
+
+        // returns true once after the profile or the number of frames in flight changed in a way that requires a new swapchain
+        auto consume_swapchain_change() -> bool;
+
+        // sleeps until the limiter allows the next frame to start
+        void limit_frame_rate();
+
+        void on_input_sampled(uint64_t frame_number);
+        void on_frame_submitted(uint64_t frame_number);
+        void on_frame_completed(uint64_t frame_number);
+
+        [[nodiscard]] auto get_stats() const -> const FramePacingStats& {
+            return stats;
+        }
+
+    private:
+        struct FrameTimes {
+            uint64_t frame_number = std::numeric_limits<uint64_t>::max();
+            Clock::time_point input{};
+            Clock::time_point submit{};
+        };
+
+        LatencyProfile profile = LatencyProfile::Throughput;
+        size_t frame_capacity = 1;
+        size_t frames_in_flight = 1;
+        float frame_rate_limit = 0.0f;
+        bool swapchain_changed = false;
+
+        Clock::time_point next_frame_time{};
+        Clock::time_point last_input_time{};
+        std::array<FrameTimes, 8> frame_times{};
+        FramePacingStats stats{};
+        float window_max_gpu_latency = 0.0f;
+        size_t window_frame_count = 0;
+    };
+
+    extern auto get_latency_profile_name(LatencyProfile profile) -> const char*;
+}
@@ -0,0 +1,147 @@
+#include "FrameReadback.hpp"
+#include "Context.hpp"
+#include "MemoryStats.hpp"
+#include "TransferQueue.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <fstream>
+#include <filesystem>
+
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::FrameReadback;
+using LoopEngine::Graphics::TransferQueue;
+
+FrameReadback::FrameReadback(Context& context, TransferQueue& transfer_queue) : context(context), transfer_queue(transfer_queue) {}
+
+void FrameReadback::initialize(size_t frame_count, vk::Extent2D image_extent, const std::string& output_directory, uint32_t frame_interval) {
+    extent = image_extent;
+    directory = output_directory;
+    interval = std::max(frame_interval, 1u);
+    if (directory.empty()) {
+        return;
+    }
+    std::filesystem::create_directories(directory);
+
+    vk::BufferCreateInfo buffer_info{};
+    buffer_info.setSize(vk::DeviceSize(extent.width) * extent.height * 4);
+    buffer_info.setUsage(vk::BufferUsageFlagBits::eTransferDst);
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+
+    slots.resize(frame_count);
+    for (auto& slot : slots) {
+        VmaAllocationInfo allocation_info{};
+        vmaCreateBuffer(context.allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, reinterpret_cast<VkBuffer *>(&slot.buffer), &slot.allocation, &allocation_info);
+        track_allocation(MemoryCategory::Staging, slot.allocation);
+        slot.mapped = allocation_info.pMappedData;
+    }
+    spdlog::info("Writing every {} frame(s) to {}", interval, directory);
+}
+
+void FrameReadback::terminate() {
+    for (auto& slot : slots) {
+        untrack_allocation(MemoryCategory::Staging, slot.allocation);
+        vmaDestroyBuffer(context.allocator, slot.buffer, slot.allocation);
+    }
+    slots.clear();
+}
+
+void FrameReadback::record(vk::CommandBuffer cmd, size_t frame, uint64_t frame_number, vk::Image image) {
+    if (!is_enabled() || frame_number % interval != 0) {
+        return;
+    }
+    auto& slot = slots[frame];
+    slot.frame_number = frame_number;
+    slot.image = image;
+    slot.transfer_value = 0;
+    slot.pending = true;
+
+    if (!transfer_queue.is_dedicated()) {
+        record_copy(cmd, slot, image);
+        return;
+    }
+
+    // release the image to the transfer queue, ownership is not returned since the next use discards the contents
+    vk::ImageMemoryBarrier barrier{};
+    barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal);
+    barrier.setNewLayout(vk::ImageLayout::eTransferSrcOptimal);
+    barrier.setSrcQueueFamilyIndex(context.graphics_queue_family_index);
+    barrier.setDstQueueFamilyIndex(context.transfer_queue_family_index);
+    barrier.setImage(image);
+    barrier.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags{}, nullptr, nullptr, barrier);
+}
+
+void FrameReadback::submit(size_t frame, vk::Semaphore semaphore, uint64_t value) {
+    if (!transfer_queue.is_dedicated() || frame >= slots.size() || !slots[frame].pending || slots[frame].transfer_value != 0) {
+        return;
+    }
+    auto& slot = slots[frame];
+
+    slot.transfer_value = transfer_queue.submit([&](vk::CommandBuffer cmd) {
+        vk::ImageMemoryBarrier barrier{};
+        barrier.setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+        barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal);
+        barrier.setNewLayout(vk::ImageLayout::eTransferSrcOptimal);
+        barrier.setSrcQueueFamilyIndex(context.graphics_queue_family_index);
+        barrier.setDstQueueFamilyIndex(context.transfer_queue_family_index);
+        barrier.setImage(slot.image);
+        barrier.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags{}, nullptr, nullptr, barrier);
+
+        record_copy(cmd, slot, slot.image);
+    }, semaphore, value, vk::PipelineStageFlagBits::eTransfer);
+}
+
+void FrameReadback::record_copy(vk::CommandBuffer cmd, const Slot& slot, vk::Image image) {
+    // whole image copies are valid for any image transfer granularity of the queue
+    vk::BufferImageCopy region{};
+    region.setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1});
+    region.setImageExtent({extent.width, extent.height, 1});
+    cmd.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, slot.buffer, region);
+
+    // make the copy visible to the host once the frame has finished
+    vk::BufferMemoryBarrier barrier{};
+    barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+    barrier.setDstAccessMask(vk::AccessFlagBits::eHostRead);
+    barrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+    barrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+    barrier.setBuffer(slot.buffer);
+    barrier.setSize(VK_WHOLE_SIZE);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, vk::DependencyFlags{}, nullptr, barrier, nullptr);
+}
+
+void FrameReadback::resolve(size_t frame) {
+    if (frame >= slots.size() || !slots[frame].pending) {
+        return;
+    }
+    auto& slot = slots[frame];
+    slot.pending = false;
+
+    transfer_queue.wait(slot.transfer_value);
+    vmaInvalidateAllocation(context.allocator, slot.allocation, 0, VK_WHOLE_SIZE);
+
+    auto path = std::filesystem::path(directory) / fmt::format("frame_{:06}.ppm", slot.frame_number);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        spdlog::error("Failed to open {}", path.string());
+        return;
+    }
+    file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+
+    // the image is stored as BGRA, ppm wants RGB
+    auto pixels = static_cast<const uint8_t*>(slot.mapped);
+    std::vector<uint8_t> row(size_t(extent.width) * 3);
+    for (uint32_t y = 0; y < extent.height; y++) {
+        auto src = pixels + size_t(y) * extent.width * 4;
+        for (uint32_t x = 0; x < extent.width; x++) {
+            row[x * 3 + 0] = src[x * 4 + 2];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 0];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size()));
+    }
+}
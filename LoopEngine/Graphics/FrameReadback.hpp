@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan.hpp>
+
+#include <string>
+#include <vector>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+    struct TransferQueue;
+
+    // Copies rendered frames into host visible buffers and writes them to disk as binary ppm images
+    // once the GPU has finished the frame. Every frame in flight owns one buffer. With a dedicated
+    // transfer queue the image is released by the graphics queue and copied on the transfer queue.
+    struct FrameReadback {
+        FrameReadback(Context& context, TransferQueue& transfer_queue);
+
+        void initialize(size_t frame_count, vk::Extent2D extent, const std::string& directory, uint32_t interval);
+        // slots that are not resolved by then are dropped
+        void terminate();
+
+        [[nodiscard]] auto is_enabled() const -> bool {
+            return !directory.empty();
+        }
+
+        // the image must be a B8G8R8A8 image in the transfer source layout whose contents are discarded by its next use
+        void record(vk::CommandBuffer cmd, size_t frame, uint64_t frame_number, vk::Image image);
+
+        // submits the copy to the transfer queue once the graphics work signalled the value
+        void submit(size_t frame, vk::Semaphore semaphore, uint64_t value);
+
+        // must only be called once the GPU has finished the frame, waits for the transfer queue
+        void resolve(size_t frame);
+
+    private:
+        struct Slot {
+            vk::Buffer buffer{};
+            VmaAllocation allocation{};
+            void* mapped = nullptr;
+            uint64_t frame_number = 0;
+            vk::Image image{};
+            uint64_t transfer_value = 0;
+            bool pending = false;
+        };
+
+        void record_copy(vk::CommandBuffer cmd, const Slot& slot, vk::Image image);
+
+        Context& context;
+        TransferQueue& transfer_queue;
+        std::vector<Slot> slots{};
+        vk::Extent2D extent{};
+        std::string directory{};
+        uint32_t interval = 1;
+    };
+}
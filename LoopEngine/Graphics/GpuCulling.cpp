@@ -0,0 +1,277 @@
+#include "GpuCulling.hpp"
+#include "Context.hpp"
+#include "Graphics.hpp"
+#include "Material.hpp"
+#include "MemoryStats.hpp"
+#include "RenderGraph.hpp"
+#include "LoopEngine/Camera/CameraSystem.hpp"
+#include "LoopEngine/Culling/FrustumCulling.hpp"
+#include "spdlog/spdlog.h"
+
+#include <array>
+#include <cstring>
+#include <algorithm>
+
+using LoopEngine::Camera::get_default_camera;
+using LoopEngine::Culling::get_camera_frustum;
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::Graphics;
+using LoopEngine::Graphics::GpuCulling;
+using LoopEngine::Graphics::RenderGraph;
+using LoopEngine::Graphics::RenderGraphQueue;
+using LoopEngine::Graphics::RenderGraphAccess;
+using LoopEngine::Graphics::RenderGraphBuilder;
+namespace RenderGraphAccesses = LoopEngine::Graphics::RenderGraphAccesses;
+using LoopEngine::Graphics::GpuCullingObject;
+using LoopEngine::Graphics::get_module_from_assets;
+
+static constexpr uint32_t workgroup_size = 64;
+static constexpr auto command_stride = static_cast<uint32_t>(sizeof(vk::DrawIndexedIndirectCommand));
+
+GpuCulling::GpuCulling(Context& context) : context(context) {}
+
+void GpuCulling::initialize(size_t frame_count, uint32_t capacity) {
+    this->capacity = capacity;
+
+    // objects, commands, count, uniforms, the depth pyramid and the object indices of the draws
+    static constexpr std::array<vk::DescriptorType, 6> binding_types{
+        vk::DescriptorType::eStorageBuffer,
+        vk::DescriptorType::eStorageBuffer,
+        vk::DescriptorType::eStorageBuffer,
+        vk::DescriptorType::eUniformBuffer,
+        vk::DescriptorType::eCombinedImageSampler,
+        vk::DescriptorType::eStorageBuffer
+    };
+
+    std::array<vk::DescriptorSetLayoutBinding, binding_types.size()> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].setBinding(i);
+        bindings[i].setDescriptorType(binding_types[i]);
+        bindings[i].setDescriptorCount(1);
+        bindings[i].setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    }
+
+    vk::DescriptorSetLayoutCreateInfo set_layout_create_info{};
+    set_layout_create_info.setBindings(bindings);
+    descriptor_set_layout = context.device.createDescriptorSetLayout(set_layout_create_info);
+
+    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.setSetLayouts(descriptor_set_layout);
+    pipeline_layout = context.device.createPipelineLayout(pipeline_layout_create_info);
+
+    auto module = get_module_from_assets("engine/shaders/gpu_culling.comp");
+    if (!module) {
+        throw std::runtime_error("Failed to load the GPU culling shader");
+    }
+
+    vk::PipelineShaderStageCreateInfo stage_create_info{};
+    stage_create_info.setStage(vk::ShaderStageFlagBits::eCompute);
+    stage_create_info.setModule(module);
+    stage_create_info.setPName("main");
+
+    vk::ComputePipelineCreateInfo pipeline_create_info{};
+    pipeline_create_info.setStage(stage_create_info);
+    pipeline_create_info.setLayout(pipeline_layout);
+    check(context.device.createComputePipelines(nullptr, 1, &pipeline_create_info, nullptr, &pipeline));
+
+    context.device.destroyShaderModule(module);
+
+    frames.resize(frame_count);
+    for (auto& frame : frames) {
+        frame.objects = create_buffer(sizeof(GpuCullingObject) * capacity, vk::BufferUsageFlagBits::eStorageBuffer, true, MemoryCategory::Indirect);
+        frame.commands = create_buffer(command_stride * capacity, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, false, MemoryCategory::Indirect);
+        frame.count = create_buffer(sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, false, MemoryCategory::Indirect);
+        frame.uniforms = create_buffer(sizeof(Uniforms), vk::BufferUsageFlagBits::eUniformBuffer, true, MemoryCategory::Uniform);
+        frame.object_indices = create_buffer(sizeof(uint32_t) * capacity, vk::BufferUsageFlagBits::eStorageBuffer, false, MemoryCategory::Indirect);
+    }
+
+    if (!context.draw_indirect_count_supported) {
+        spdlog::warn("Draw indirect count is not supported, culled draws are drawn with zero index count");
+    }
+    if (!context.draw_indirect_first_instance_supported) {
+        spdlog::warn("Draw indirect first instance is not supported, per-object data has to be read through the object index buffer");
+    }
+}
+
+void GpuCulling::terminate() {
+    for (auto& frame : frames) {
+        release_buffer(frame.objects, MemoryCategory::Indirect);
+        release_buffer(frame.commands, MemoryCategory::Indirect);
+        release_buffer(frame.count, MemoryCategory::Indirect);
+        release_buffer(frame.uniforms, MemoryCategory::Uniform);
+        release_buffer(frame.object_indices, MemoryCategory::Indirect);
+    }
+    frames.clear();
+    objects.clear();
+
+    context.device.destroyPipeline(pipeline);
+    context.device.destroyPipelineLayout(pipeline_layout);
+    context.device.destroyDescriptorSetLayout(descriptor_set_layout);
+}
+
+void GpuCulling::set_objects(std::span<const GpuCullingObject> objects) {
+    if (objects.size() > capacity) {
+        spdlog::warn("GPU culling capacity exceeded, {} of {} objects are dropped", objects.size() - capacity, objects.size());
+        objects = objects.first(capacity);
+    }
+
+    this->objects.assign(objects.begin(), objects.end());
+    for (auto& frame : frames) {
+        frame.dirty = true;
+    }
+}
+
+void GpuCulling::add_pass(RenderGraph& graph) {
+    // every frame in flight owns its buffers and rewrites them completely, the previous frame that used
+    // them has finished before the frame starts, so the culling does not wait for the graphics work
+    static constexpr auto frame_initial_access = RenderGraphAccess{
+        vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::AccessFlags{}
+    };
+
+    auto commands = graph.import_buffer("gpu_culling_commands", command_stride * capacity, frame_initial_access, RenderGraphAccess{});
+    auto count = graph.import_buffer("gpu_culling_count", sizeof(uint32_t), frame_initial_access, RenderGraphAccess{});
+    auto object_indices = graph.import_buffer("gpu_culling_object_indices", sizeof(uint32_t) * capacity, frame_initial_access, RenderGraphAccess{});
+    auto pyramid = Graphics::get_instance()->get_depth_pyramid_resource();
+
+    graph.add_resource_binder([this, commands, count, object_indices](RenderGraph& graph) {
+        auto& buffers = frames[Graphics::get_instance()->get_current_frame()];
+        graph.set_buffer(commands, buffers.commands.buffer);
+        graph.set_buffer(count, buffers.count.buffer);
+        graph.set_buffer(object_indices, buffers.object_indices.buffer);
+    });
+
+    graph.add_pass("gpu_culling", RenderGraphQueue::Compute, [pyramid, commands, count, object_indices](RenderGraphBuilder& builder) {
+        builder.read(pyramid, RenderGraphAccesses::compute_storage_read);
+        builder.write(commands, RenderGraphAccesses::compute_buffer_write);
+        builder.write(count, RenderGraphAccesses::compute_buffer_write);
+        builder.write(object_indices, RenderGraphAccesses::compute_buffer_write);
+    }, [this](vk::CommandBuffer cmd, RenderGraph& graph) {
+        record_culling(cmd, Graphics::get_instance()->get_current_frame(), *get_default_camera());
+    });
+
+    // the draws are recorded by the main pass, this pass only makes the results of the culling available to it,
+    // with async compute the graph acquires the buffers from the compute queue and waits for its submission
+    graph.add_pass("gpu_culling_draw", RenderGraphQueue::Graphics, [commands, count, object_indices](RenderGraphBuilder& builder) {
+        builder.read(commands, RenderGraphAccesses::indirect_buffer);
+        builder.read(count, RenderGraphAccesses::indirect_buffer);
+        builder.read(object_indices, RenderGraphAccesses::vertex_storage_buffer);
+        builder.set_side_effects();
+    }, [](vk::CommandBuffer cmd, RenderGraph& graph) {});
+}
+
+void GpuCulling::record_culling(vk::CommandBuffer cmd, size_t frame, const LoopEngine::Camera::Camera& camera) {
+    auto& buffers = frames[frame];
+    if (buffers.dirty) {
+        // the GPU has finished the previous use of the frame, host writes are made visible by the submission
+        std::memcpy(buffers.objects.mapped, objects.data(), sizeof(GpuCullingObject) * objects.size());
+        vmaFlushAllocation(context.allocator, buffers.objects.allocation, 0, VK_WHOLE_SIZE);
+        buffers.object_count = static_cast<uint32_t>(objects.size());
+        buffers.dirty = false;
+    }
+
+    cmd.fillBuffer(buffers.count.buffer, 0, sizeof(uint32_t), 0);
+    if (!context.draw_indirect_count_supported && buffers.object_count > 0) {
+        // every command is drawn, the ones that are not written by the shader must draw nothing
+        cmd.fillBuffer(buffers.commands.buffer, 0, command_stride * buffers.object_count, 0);
+    }
+
+    vk::MemoryBarrier clear_barrier{};
+    clear_barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+    clear_barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags{}, clear_barrier, nullptr, nullptr);
+
+    if (buffers.object_count > 0) {
+        auto& depth_pyramid = Graphics::get_instance()->get_depth_pyramid();
+        auto depth_extent = depth_pyramid.get_source_extent();
+        auto pyramid_extent = depth_pyramid.get_extent();
+
+        Uniforms uniforms{};
+        auto frustum = get_camera_frustum(camera);
+        std::copy(frustum.planes.begin(), frustum.planes.end(), uniforms.planes);
+        uniforms.pyramid_view_projection = depth_pyramid.get_view_projection();
+        uniforms.depth_extent = glm::vec2(depth_extent.width, depth_extent.height);
+        uniforms.pyramid_extent = glm::vec2(pyramid_extent.width, pyramid_extent.height);
+        uniforms.object_count = buffers.object_count;
+        uniforms.pyramid_levels = depth_pyramid.get_mip_levels();
+        uniforms.occlusion = occlusion_culling && Graphics::get_instance()->is_depth_pyramid_enabled() && depth_pyramid.is_built() ? 1 : 0;
+        uniforms.radius_bias = glm::length(camera.get_position() - depth_pyramid.get_camera_position());
+        uniforms.first_instance = context.draw_indirect_first_instance_supported ? 1 : 0;
+
+        std::memcpy(buffers.uniforms.mapped, &uniforms, sizeof(Uniforms));
+        vmaFlushAllocation(context.allocator, buffers.uniforms.allocation, 0, VK_WHOLE_SIZE);
+
+        std::array<vk::DescriptorBufferInfo, 4> buffer_infos{
+            vk::DescriptorBufferInfo{buffers.objects.buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{buffers.commands.buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{buffers.count.buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{buffers.uniforms.buffer, 0, VK_WHOLE_SIZE}
+        };
+        vk::DescriptorBufferInfo object_indices_info{buffers.object_indices.buffer, 0, VK_WHOLE_SIZE};
+        vk::DescriptorImageInfo pyramid_info{depth_pyramid.get_sampler(), depth_pyramid.get_view(), vk::ImageLayout::eGeneral};
+
+        auto descriptor_set = Graphics::get_instance()->allocate_transient_descriptor_set(descriptor_set_layout);
+
+        std::array<vk::WriteDescriptorSet, 6> writes{};
+        for (uint32_t i = 0; i < writes.size(); i++) {
+            writes[i].setDstSet(descriptor_set);
+            writes[i].setDstBinding(i);
+            writes[i].setDescriptorCount(1);
+        }
+        for (uint32_t i = 0; i < buffer_infos.size(); i++) {
+            writes[i].setDescriptorType(i < 3 ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer);
+            writes[i].setPBufferInfo(&buffer_infos[i]);
+        }
+        writes[4].setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+        writes[4].setPImageInfo(&pyramid_info);
+        writes[5].setDescriptorType(vk::DescriptorType::eStorageBuffer);
+        writes[5].setPBufferInfo(&object_indices_info);
+        context.device.updateDescriptorSets(writes, nullptr);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeline_layout, 0, descriptor_set, {});
+        cmd.dispatch((buffers.object_count + workgroup_size - 1) / workgroup_size, 1, 1);
+    }
+}
+
+void GpuCulling::draw(vk::CommandBuffer cmd, size_t frame) const {
+    auto& buffers = frames[frame];
+    if (buffers.object_count == 0) {
+        return;
+    }
+
+    if (context.draw_indirect_count_supported) {
+        cmd.drawIndexedIndirectCount(buffers.commands.buffer, 0, buffers.count.buffer, 0, buffers.object_count, command_stride);
+    } else if (context.multi_draw_indirect_supported) {
+        cmd.drawIndexedIndirect(buffers.commands.buffer, 0, buffers.object_count, command_stride);
+    } else {
+        for (uint32_t i = 0; i < buffers.object_count; i++) {
+            cmd.drawIndexedIndirect(buffers.commands.buffer, vk::DeviceSize(i) * command_stride, 1, command_stride);
+        }
+    }
+}
+
+auto GpuCulling::create_buffer(vk::DeviceSize size, vk::BufferUsageFlags usage, bool host_visible, MemoryCategory category) -> Buffer {
+    vk::BufferCreateInfo buffer_info{};
+    buffer_info.setSize(std::max<vk::DeviceSize>(size, 4));
+    buffer_info.setUsage(usage);
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    if (host_visible) {
+        alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    }
+
+    Buffer buffer{};
+    VmaAllocationInfo allocation_info{};
+    vmaCreateBuffer(context.allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, reinterpret_cast<VkBuffer *>(&buffer.buffer), &buffer.allocation, &allocation_info);
+    track_allocation(category, buffer.allocation);
+
+    buffer.mapped = allocation_info.pMappedData;
+    return buffer;
+}
+
+void GpuCulling::release_buffer(const Buffer& buffer, MemoryCategory category) {
+    untrack_allocation(category, buffer.allocation);
+    vmaDestroyBuffer(context.allocator, buffer.buffer, buffer.allocation);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "MemoryStats.hpp"
+#include "glm/glm.hpp"
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan.hpp>
+
+#include <span>
+#include <vector>
+
+namespace LoopEngine::Camera {
+    struct Camera;
+}
+
+namespace LoopEngine::Graphics {
+    struct Context;
+    struct RenderGraph;
+
+    // matches the object layout of the culling shader
+    struct GpuCullingObject {
+        // xyz - center, w - radius of the bounding sphere in world space
+        glm::vec4 bounds{};
+        uint32_t index_count = 0;
+        uint32_t first_index = 0;
+        int32_t vertex_offset = 0;
+        uint32_t padding = 0;
+    };
+
+    // Culls objects against the camera frustum in a compute pass and compacts the visible ones into an indirect
+    // buffer, so the CPU records a single draw regardless of the object count. When the device supports
+    // drawIndirectFirstInstance the object index is passed as the first instance of its draw, per-object data is
+    // read from instanced vertex attributes or gl_InstanceIndex. Otherwise the first instance is zero and the object
+    // index of every draw is only available in the object index buffer, indexed with gl_DrawID.
+    // With occlusion culling objects hidden behind the depth pyramid of the previous frame are rejected as well.
+    struct GpuCulling {
+        explicit GpuCulling(Context& context);
+
+        void initialize(size_t frame_count, uint32_t capacity);
+        void terminate();
+
+        // the objects are uploaded to every frame in flight before its culling pass
+        void set_objects(std::span<const GpuCullingObject> objects);
+
+        [[nodiscard]] auto get_capacity() const -> uint32_t {
+            return capacity;
+        }
+
+        [[nodiscard]] auto get_object_count() const -> uint32_t {
+            return static_cast<uint32_t>(objects.size());
+        }
+
+        void set_occlusion_culling(bool enabled) {
+            occlusion_culling = enabled;
+        }
+
+        [[nodiscard]] auto is_occlusion_culling() const -> bool {
+            return occlusion_culling;
+        }
+
+        // the object index of every written draw, ready for the vertex shader once the culling pass has run
+        [[nodiscard]] auto get_object_index_buffer(size_t frame) const -> vk::Buffer {
+            return frames[frame].object_indices.buffer;
+        }
+
+        // adds a compute pass that culls the objects against the default camera and a graphics pass that makes its
+        // results available to the draws, must be added before the main pass. The buffers of the frame in flight are
+        // imported into the graph, with async compute the culling runs on the compute queue
+        void add_pass(RenderGraph& graph);
+
+        // must be recorded outside of a render pass, the caller makes the results visible to the draws
+        void record_culling(vk::CommandBuffer cmd, size_t frame, const LoopEngine::Camera::Camera& camera);
+
+        // draws the visible objects, the caller binds the pipeline, descriptor sets, vertex and index buffers
+        void draw(vk::CommandBuffer cmd, size_t frame) const;
+
+    private:
+        struct Buffer {
+            vk::Buffer buffer{};
+            VmaAllocation allocation{};
+            void* mapped = nullptr;
+        };
+
+        struct FrameBuffers {
+            Buffer objects{};
+            Buffer commands{};
+            Buffer count{};
+            Buffer uniforms{};
+            Buffer object_indices{};
+            uint32_t object_count = 0;
+            bool dirty = false;
+        };
+
+        // matches the uniform block of the culling shader
+        struct Uniforms {
+            glm::vec4 planes[6];
+            glm::mat4 pyramid_view_projection;
+            glm::vec2 depth_extent;
+            glm::vec2 pyramid_extent;
+            uint32_t object_count;
+            uint32_t pyramid_levels;
+            uint32_t occlusion;
+            float radius_bias;
+            uint32_t first_instance;
+        };
+
+        auto create_buffer(vk::DeviceSize size, vk::BufferUsageFlags usage, bool host_visible, MemoryCategory category) -> Buffer;
+        void release_buffer(const Buffer& buffer, MemoryCategory category);
+
+        Context& context;
+        uint32_t capacity = 0;
+        bool occlusion_culling = true;
+        std::vector<GpuCullingObject> objects{};
+        std::vector<FrameBuffers> frames{};
+
+        vk::DescriptorSetLayout descriptor_set_layout{};
+        vk::PipelineLayout pipeline_layout{};
+        vk::Pipeline pipeline{};
+    };
+}
@@ -0,0 +1,186 @@
+#include "GpuProfiler.hpp"
+#include "Context.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::GpuProfiler;
+using LoopEngine::Graphics::GpuScopeId;
+using LoopEngine::Graphics::GpuScopeStats;
+using LoopEngine::Graphics::GpuProfileScope;
+
+GpuProfiler::GpuProfiler(Context& context) : context(context) {}
+
+void GpuProfiler::initialize(size_t frame_count) {
+    auto properties = context.physical_device.getProperties();
+    auto queue_families = context.physical_device.getQueueFamilyProperties();
+    auto valid_bits = queue_families[context.graphics_queue_family_index].timestampValidBits;
+
+    supported = valid_bits != 0 && properties.limits.timestampPeriod > 0.0f;
+    if (!supported) {
+        spdlog::warn("GPU profiler disabled, the graphics queue does not support timestamps");
+        return;
+    }
+    timestamp_period = properties.limits.timestampPeriod;
+    timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+    vk::QueryPoolCreateInfo pool_info{};
+    pool_info.setQueryType(vk::QueryType::eTimestamp);
+    pool_info.setQueryCount(max_scopes_per_frame * 2);
+
+    frames.resize(frame_count);
+    for (auto& queries : frames) {
+        queries.pool = context.device.createQueryPool(pool_info);
+    }
+}
+
+void GpuProfiler::terminate() {
+    for (auto& queries : frames) {
+        context.device.destroyQueryPool(queries.pool);
+    }
+    frames.clear();
+    recording = false;
+}
+
+auto GpuProfiler::register_scope(std::string_view name) -> GpuScopeId {
+    std::lock_guard lock(scopes_mutex);
+    for (size_t i = 0; i < scopes.size(); i++) {
+        if (scopes[i].name == name) {
+            return static_cast<GpuScopeId>(i);
+        }
+    }
+    auto& history = scopes.emplace_back();
+    history.name = std::string(name);
+    history.stats.name = history.name;
+    return static_cast<GpuScopeId>(scopes.size() - 1);
+}
+
+void GpuProfiler::begin_frame(vk::CommandBuffer cmd, size_t frame) {
+    if (!supported) {
+        return;
+    }
+    if (recording) {
+        frames[recording_frame].used = std::min(next_query.load(), max_scopes_per_frame);
+    }
+
+    auto& queries = frames[frame];
+    if (queries.used > 0) {
+        collect(queries);
+        queries.used = 0;
+    }
+    cmd.resetQueryPool(queries.pool, 0, max_scopes_per_frame * 2);
+
+    recording_frame = frame;
+    recording = true;
+    next_query.store(0);
+}
+
+auto GpuProfiler::begin_scope(vk::CommandBuffer cmd, GpuScopeId scope) -> uint32_t {
+    if (!recording) {
+        return invalid_query;
+    }
+    auto query = next_query.fetch_add(1, std::memory_order_relaxed);
+    if (query >= max_scopes_per_frame) {
+        return invalid_query;
+    }
+    auto& queries = frames[recording_frame];
+    queries.scopes[query] = scope;
+    cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queries.pool, query * 2);
+    return query;
+}
+
+void GpuProfiler::end_scope(vk::CommandBuffer cmd, uint32_t query) {
+    if (query == invalid_query) {
+        return;
+    }
+    cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, frames[recording_frame].pool, query * 2 + 1);
+}
+
+void GpuProfiler::collect(FrameQueries& queries) {
+    // every query is followed by its availability, a scope that was never closed is skipped
+    std::vector<uint64_t> results(size_t(queries.used) * 4);
+    auto result = context.device.getQueryPoolResults(
+        queries.pool,
+        0,
+        queries.used * 2,
+        results.size() * sizeof(uint64_t),
+        results.data(),
+        sizeof(uint64_t) * 2,
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability
+    );
+    if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+        check(result);
+    }
+
+    std::lock_guard lock(scopes_mutex);
+
+    // a scope recorded several times in a frame reports the sum of its durations
+    std::vector<float> frame_times(scopes.size(), -1.0f);
+    for (uint32_t i = 0; i < queries.used; i++) {
+        auto begin = results[i * 4 + 0];
+        auto begin_available = results[i * 4 + 1];
+        auto end = results[i * 4 + 2];
+        auto end_available = results[i * 4 + 3];
+        if (begin_available == 0 || end_available == 0) {
+            continue;
+        }
+        auto ticks = (end - begin) & timestamp_mask;
+        auto time = static_cast<float>(double(ticks) * timestamp_period * 1e-6);
+
+        auto& frame_time = frame_times[queries.scopes[i]];
+        frame_time = std::max(frame_time, 0.0f) + time;
+    }
+    for (size_t i = 0; i < scopes.size(); i++) {
+        if (frame_times[i] >= 0.0f) {
+            add_sample(scopes[i], frame_times[i]);
+        }
+    }
+}
+
+void GpuProfiler::add_sample(ScopeHistory& history, float time) {
+    history.samples[history.head] = time;
+    history.head = (history.head + 1) % history_size;
+    history.count = std::min(history.count + 1, history_size);
+
+    auto min_time = std::numeric_limits<float>::max();
+    auto max_time = 0.0f;
+    auto sum = 0.0f;
+    for (size_t i = 0; i < history.count; i++) {
+        min_time = std::min(min_time, history.samples[i]);
+        max_time = std::max(max_time, history.samples[i]);
+        sum += history.samples[i];
+    }
+
+    history.stats.last_time = time;
+    history.stats.min_time = min_time;
+    history.stats.max_time = max_time;
+    history.stats.avg_time = sum / static_cast<float>(history.count);
+}
+
+auto GpuProfiler::get_scope_stats() const -> std::vector<GpuScopeStats> {
+    std::lock_guard lock(scopes_mutex);
+
+    std::vector<GpuScopeStats> stats{};
+    stats.reserve(scopes.size());
+    for (auto& history : scopes) {
+        stats.emplace_back(history.stats);
+    }
+    return stats;
+}
+
+auto GpuProfiler::get_scope_stats(GpuScopeId scope) const -> GpuScopeStats {
+    std::lock_guard lock(scopes_mutex);
+    return scopes[scope].stats;
+}
+
+GpuProfileScope::GpuProfileScope(GpuProfiler& profiler, vk::CommandBuffer cmd, GpuScopeId scope) : profiler(profiler), cmd(cmd) {
+    query = profiler.begin_scope(cmd, scope);
+}
+
+GpuProfileScope::GpuProfileScope(GpuProfiler& profiler, vk::CommandBuffer cmd, std::string_view name) : GpuProfileScope(profiler, cmd, profiler.register_scope(name)) {}
+
+GpuProfileScope::~GpuProfileScope() {
+    profiler.end_scope(cmd, query);
+}
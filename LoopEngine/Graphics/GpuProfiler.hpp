@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <limits>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <string_view>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+
+    using GpuScopeId = uint32_t;
+
+    // times are in milliseconds, aggregated over the last frames the scope was recorded in
+    struct GpuScopeStats {
+        std::string name{};
+        float last_time = 0.0f;
+        float min_time = 0.0f;
+        float avg_time = 0.0f;
+        float max_time = 0.0f;
+    };
+
+    // Measures GPU time of named scopes with timestamp queries. Every frame in flight owns a query pool,
+    // its results are read back when the frame is reused, so the host never waits for the queries.
+    // Scopes may be recorded from several threads and into secondary command buffers.
+    struct GpuProfiler {
+        static constexpr uint32_t invalid_query = std::numeric_limits<uint32_t>::max();
+
+        explicit GpuProfiler(Context& context);
+
+        void initialize(size_t frame_count);
+        void terminate();
+
+        [[nodiscard]] auto is_supported() const -> bool {
+            return supported;
+        }
+
+        // thread safe, the same name always maps to the same scope
+        auto register_scope(std::string_view name) -> GpuScopeId;
+
+        // collects the results of the previous use of the frame and resets its queries,
+        // must be recorded outside of a render pass once the GPU has finished the frame
+        void begin_frame(vk::CommandBuffer cmd, size_t frame);
+
+        auto begin_scope(vk::CommandBuffer cmd, GpuScopeId scope) -> uint32_t;
+        void end_scope(vk::CommandBuffer cmd, uint32_t query);
+
+        [[nodiscard]] auto get_scope_stats() const -> std::vector<GpuScopeStats>;
+        [[nodiscard]] auto get_scope_stats(GpuScopeId scope) const -> GpuScopeStats;
+
+    private:
+        static constexpr uint32_t max_scopes_per_frame = 256;
+        static constexpr size_t history_size = 120;
+
+        struct FrameQueries {
+            vk::QueryPool pool{};
+            std::array<GpuScopeId, max_scopes_per_frame> scopes{};
+            uint32_t used = 0;
+        };
+
+        struct ScopeHistory {
+            std::string name{};
+            std::array<float, history_size> samples{};
+            size_t count = 0;
+            size_t head = 0;
+            GpuScopeStats stats{};
+        };
+
+        void collect(FrameQueries& queries);
+        void add_sample(ScopeHistory& history, float time);
+
+        Context& context;
+        bool supported = false;
+        float timestamp_period = 1.0f;
+        uint64_t timestamp_mask = ~0ull;
+
+        std::vector<FrameQueries> frames{};
+        size_t recording_frame = 0;
+        bool recording = false;
+        std::atomic<uint32_t> next_query{0};
+
+        mutable std::mutex scopes_mutex{};
+        std::vector<ScopeHistory> scopes{};
+    };
+
+    // writes a timestamp pair around its lifetime
+    struct GpuProfileScope {
+        GpuProfileScope(GpuProfiler& profiler, vk::CommandBuffer cmd, GpuScopeId scope);
+        // looks the name up under a lock on every use, hot paths register their scope once and pass the id
+        GpuProfileScope(GpuProfiler& profiler, vk::CommandBuffer cmd, std::string_view name);
+        ~GpuProfileScope();
+
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+    private:
+        GpuProfiler& profiler;
+        vk::CommandBuffer cmd;
+        uint32_t query;
+    };
+}
@@ -1,11 +1,14 @@
 #include "Graphics.hpp"
 #include "Context.hpp"
 #include "Material.hpp"
+#include "MemoryStats.hpp"
 #include "UniformBuffer.hpp"
 #include "LoopEngine/Application.hpp"
 #include "LoopEngine/Platform/Window.hpp"
 #include "LoopEngine/Camera/Camera.hpp"
 #include "LoopEngine/Camera/CameraSystem.hpp"
+#include "LoopEngine/Job/JobSystem.hpp"
+#include "LoopEngine/Profiler/CpuProfiler.hpp"
 
 #include <set>
 #include "GLFW/glfw3.h"
@@ -19,10 +22,30 @@ using LoopEngine::Core::Singleton;
 using LoopEngine::Platform::Window;
 using LoopEngine::Graphics::Context;
 using LoopEngine::Graphics::Graphics;
+using LoopEngine::Job::JobSystem;
 using LoopEngine::Camera::get_default_camera;
+using LoopEngine::Event::EventSystem;
+using LoopEngine::Event::DrawEvent;
+using LoopEngine::Event::AfterDrawEvent;
+using LoopEngine::Event::BeforeDrawEvent;
+using LoopEngine::Graphics::RenderGraph;
+using LoopEngine::Graphics::RenderGraphQueue;
+using LoopEngine::Graphics::RenderGraphAccess;
+using LoopEngine::Graphics::RenderGraphBuilder;
+using LoopEngine::Graphics::FrameGraphStage;
+using LoopEngine::Graphics::FrameGraphSetupEvent;
+using LoopEngine::Graphics::ParallelDrawEvent;
+using LoopEngine::Graphics::LatencyProfile;
+using LoopEngine::Graphics::GpuProfiler;
+using LoopEngine::Graphics::GpuProfileScope;
+
+namespace RenderGraphAccesses = LoopEngine::Graphics::RenderGraphAccesses;
 
 template<> Graphics* Singleton<Graphics>::instance = nullptr;
 
+// sorted packets recorded by one task, large enough that redundant binds at chunk starts do not matter
+static constexpr size_t render_queue_chunk_size = 256;
+
 static auto select_surface_extent(const vk::Extent2D& extent, const vk::SurfaceCapabilitiesKHR &capabilities) -> vk::Extent2D {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
@@ -35,42 +58,118 @@ static auto select_surface_extent(const vk::Extent2D& extent, const vk::SurfaceC
 Graphics::Graphics(Context& context) : context(context) {}
 
 void Graphics::initialize() {
-    create_surface();
-    create_swapchain();
+    frame_pacing.initialize(maxFramesInFlight);
+    frame_pacing.set_profile(LatencyProfile::Throughput);
+
+    if (context.headless) {
+        create_offscreen_images();
+    } else {
+        create_surface();
+        create_swapchain(nullptr);
+    }
     create_sync_objects();
     create_command_pools();
     create_command_buffers();
+    transfer_queue.initialize();
+    command_recorder.initialize(maxFramesInFlight, JobSystem::get_instance()->get_thread_count());
+    gpu_profiler.initialize(maxFramesInFlight);
+    frame_scope = gpu_profiler.register_scope("Frame");
+    render_queue_scope = gpu_profiler.register_scope("RenderQueue");
+    before_draw_scope = gpu_profiler.register_scope("BeforeDraw");
+    draw_scope = gpu_profiler.register_scope("Draw");
+    upscale_scope = gpu_profiler.register_scope("Upscale");
+    after_draw_scope = gpu_profiler.register_scope("AfterDraw");
+    descriptor_allocator.initialize(maxFramesInFlight);
+    instance_buffer.initialize(maxFramesInFlight, 64 * 1024);
     create_default_descriptors();
+    depth_pyramid_enabled = Application::get_instance()->get_options().occlusion_culling;
     create_default_render_pass();
+    create_ui_render_pass();
     create_default_framebuffers();
 //        create_material_descriptor_pool();
+
+    if (context.headless) {
+        auto& options = Application::get_instance()->get_options();
+        frame_readback.initialize(maxFramesInFlight, surface_extent, options.readback_directory, options.readback_interval);
+    }
+
+    frame_graph.set_release_handler([this](std::function<void()> function) {
+        defer_release(std::move(function));
+    });
+
+    // the scale is driven by timestamps, without them the scene is always rendered at full resolution
+    dynamic_resolution.set_enabled(Application::get_instance()->get_options().dynamic_resolution && gpu_profiler.is_supported());
+    spdlog::info("Dynamic resolution {}", dynamic_resolution.is_enabled() ? "enabled" : "disabled");
+
+    depth_pyramid.initialize();
+    depth_pyramid.set_release_handler([this](std::function<void()> function) {
+        defer_release(std::move(function));
+    });
+
+    // compute passes only gain from their own queue when it belongs to a separate family
+    auto async_compute = context.compute_queue_family_index != context.graphics_queue_family_index;
+    frame_graph.set_async_compute(async_compute);
+    spdlog::info("Async compute {}", async_compute ? "enabled" : "disabled");
 }
 
 void Graphics::terminate() {
+    // the last frames in flight still hold captured images, they are written out instead of dropped
+    for (size_t i = 0; i < submitted_frames.size(); i++) {
+        if (submitted_frames[i] != std::numeric_limits<uint64_t>::max()) {
+            wait_for_frame(submitted_frames[i]);
+            frame_readback.resolve(i);
+        }
+    }
+
+    frame_graph.reset();
+    depth_pyramid.terminate();
+    flush_released_objects(true);
+    command_recorder.terminate();
+    gpu_profiler.terminate();
+    descriptor_allocator.terminate();
+    instance_buffer.terminate();
+    frame_readback.terminate();
+    transfer_queue.terminate();
+
     for (size_t i = 0; i < views.size(); i++) {
         context.device.destroyImageView(views[i]);
-        context.device.destroyImageView(depth_views[i]);
-        context.device.destroyFramebuffer(default_framebuffers[i]);
-
-        vmaDestroyImage(context.allocator, depth_images[i], depth_allocations[i]);
+        context.device.destroyFramebuffer(ui_framebuffers[i]);
+    }
+    context.device.destroyFramebuffer(default_framebuffer);
+    context.device.destroyImageView(scene_view);
+    untrack_allocation(MemoryCategory::Texture, scene_allocation);
+    vmaDestroyImage(context.allocator, scene_image, scene_allocation);
+    context.device.destroyImageView(depth_view);
+    untrack_allocation(MemoryCategory::Depth, depth_allocation);
+    vmaDestroyImage(context.allocator, depth_image, depth_allocation);
+    for (size_t i = 0; i < offscreen_allocations.size(); i++) {
+        untrack_allocation(MemoryCategory::Texture, offscreen_allocations[i]);
+        vmaDestroyImage(context.allocator, images[i], offscreen_allocations[i]);
     }
 
+    context.device.destroySemaphore(frame_timeline);
+    context.device.destroySemaphore(compute_timeline);
     for (size_t i = 0; i < maxFramesInFlight; i++) {
-        context.device.destroyFence(fences[i]);
         context.device.destroySemaphore(image_available_semaphores[i]);
         context.device.destroySemaphore(render_finished_semaphores[i]);
 
         context.device.freeCommandBuffers(command_pools[i], 1, &command_buffers[i]);
         context.device.destroyCommandPool(command_pools[i]);
 
+        context.device.freeCommandBuffers(compute_command_pools[i], 1, &compute_command_buffers[i]);
+        context.device.destroyCommandPool(compute_command_pools[i]);
+
         release_uniform_buffer(*global_uniform_buffers[i]);
     }
     context.device.destroyDescriptorSetLayout(global_descriptor_set_layout);
     context.device.destroyDescriptorPool(global_descriptor_pool);
     context.device.destroyRenderPass(default_render_pass);
+    context.device.destroyRenderPass(ui_render_pass);
 
-    context.device.destroySwapchainKHR(swapchain);
-    context.instance.destroySurfaceKHR(surface);
+    if (!context.headless) {
+        context.device.destroySwapchainKHR(swapchain);
+        context.instance.destroySurfaceKHR(surface);
+    }
 }
 
 auto Graphics::begin_single_time_commands() -> vk::CommandBuffer {
@@ -108,28 +207,65 @@ void Graphics::submit_single_time_commands(vk::CommandBuffer cmd) {
     context.device.destroyFence(fence);
 }
 
+void Graphics::wait_for_frame(uint64_t frame) {
+    if (frame < completed_frame_count) {
+        return;
+    }
+
+    // compute work of the frame may still run when the graphics work does not depend on it, a frame that is
+    // no longer in flight had its compute work waited for before its slot was reused
+    uint64_t compute_value = 0;
+    for (size_t i = 0; i < submitted_frames.size(); i++) {
+        if (submitted_frames[i] == frame) {
+            compute_value = submitted_compute_values[i];
+        }
+    }
+
+    vk::Semaphore semaphores[] = {frame_timeline, compute_timeline};
+    uint64_t values[] = {get_frame_timeline_value(frame), compute_value};
+
+    vk::SemaphoreWaitInfo wait_info{};
+    wait_info.setSemaphores(semaphores);
+    wait_info.setValues(values);
+    check(context.device.waitSemaphores(wait_info, std::numeric_limits<uint64_t>::max()));
+
+    update_completed_frames(query_completed_frame_count());
+}
+
+auto Graphics::is_frame_complete(uint64_t frame) -> bool {
+    if (frame >= completed_frame_count) {
+        update_completed_frames(query_completed_frame_count());
+    }
+    return frame < completed_frame_count;
+}
+
+void Graphics::begin_frame() {
+    // the frame that used the same resources last has to be finished, slots never used start out free
+    if (submitted_frames[current_frame] != std::numeric_limits<uint64_t>::max()) {
+        wait_for_frame(submitted_frames[current_frame]);
+    }
+    update_completed_frames(query_completed_frame_count());
+    flush_released_objects(false);
+    transfer_queue.collect();
+    descriptor_allocator.reset_frame(current_frame);
+    instance_buffer.reset_frame(current_frame);
+    frame_readback.resolve(current_frame);
+
+    frame_pacing.limit_frame_rate();
+    frame_pacing.on_input_sampled(frame_number);
+}
+
 auto Graphics::setup_frame() -> vk::Result {
-    // wait for fence to be signaled
-    static constexpr auto timeout = std::numeric_limits<uint64_t>::max();
-    check(context.device.waitForFences(1, &fences[current_frame], true, timeout));
+    LOOP_PROFILE_SCOPE("SetupFrame");
 
-    // acquire next image
-    image_index = std::numeric_limits<uint32_t>::max();
-    auto result = context.device.acquireNextImageKHR(
-        swapchain,
-        std::numeric_limits<uint64_t>::max(),
-        image_available_semaphores[current_frame],
-        vk::Fence{},
-        &image_index
-    );
+    auto result = context.headless ? acquire_offscreen_image() : acquire_swapchain_image();
     if (result == vk::Result::eErrorOutOfDateKHR) {
-        recreate_swapchain();
         return result;
-    } else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
-        throw std::runtime_error(vk::to_string(result));
     }
 
-    check(context.device.resetFences(1, &fences[current_frame]));
+    command_recorder.reset_frame(current_frame);
+
+    update_memory_stats(static_cast<uint32_t>(frame_number));
 
     auto camera = get_default_camera();
 
@@ -142,38 +278,121 @@ auto Graphics::setup_frame() -> vk::Result {
     vk::CommandBufferBeginInfo begin_info{};
     begin_info.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
     command_buffers[current_frame].begin(begin_info);
+
+    gpu_profiler.begin_frame(command_buffers[current_frame], current_frame);
+
+    // the timings of the last frame that used these resources were just read back
+    if (gpu_profiler.is_supported()) {
+        dynamic_resolution.update(gpu_profiler.get_scope_stats(frame_scope).last_time, frame_pacing.get_frames_in_flight());
+    }
+    render_extent = dynamic_resolution.get_render_extent(surface_extent);
+
+    transfer_wait_stages = transfer_queue.flush(command_buffers[current_frame]);
+    frame_query = gpu_profiler.begin_scope(command_buffers[current_frame], frame_scope);
     return result;
 }
 
+void Graphics::execute_frame_graph() {
+    if (frame_graph_dirty || !frame_graph.is_compiled()) {
+        build_frame_graph();
+    }
+    depth_pyramid.set_render_extent(render_extent);
+
+    frame_graph.set_image(swapchain_resource, images[image_index], views[image_index]);
+    frame_graph.set_image(scene_resource, scene_image, scene_view);
+    frame_graph.set_image(depth_resource, depth_image, depth_view);
+    frame_graph.set_image(depth_pyramid_resource, depth_pyramid.get_image(), depth_pyramid.get_view());
+
+    vk::CommandBuffer compute_cmd{};
+    if (frame_graph.has_compute_work()) {
+        compute_cmd = compute_command_buffers[current_frame];
+
+        vk::CommandBufferBeginInfo begin_info{};
+        begin_info.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        compute_cmd.begin(begin_info);
+    }
+
+    frame_graph.execute(command_buffers[current_frame], compute_cmd);
+
+    if (compute_cmd) {
+        compute_cmd.end();
+        compute_recorded = true;
+    }
+
+    gpu_profiler.end_scope(command_buffers[current_frame], frame_query);
+    frame_query = GpuProfiler::invalid_query;
+}
+
+auto Graphics::acquire_swapchain_image() -> vk::Result {
+    if (frame_pacing.consume_swapchain_change()) {
+        swapchain_outdated = true;
+    }
+    if (swapchain_outdated && !recreate_swapchain()) {
+        return vk::Result::eErrorOutOfDateKHR;
+    }
+
+    // acquire next image
+    image_index = std::numeric_limits<uint32_t>::max();
+    auto result = context.device.acquireNextImageKHR(
+        swapchain,
+        std::numeric_limits<uint64_t>::max(),
+        image_available_semaphores[current_frame],
+        vk::Fence{},
+        &image_index
+    );
+    if (result == vk::Result::eErrorOutOfDateKHR) {
+        swapchain_outdated = true;
+        recreate_swapchain();
+        return result;
+    } else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
+        throw std::runtime_error(vk::to_string(result));
+    }
+    return result;
+}
+
+auto Graphics::acquire_offscreen_image() -> vk::Result {
+    // every frame in flight renders into its own image, the frame timeline guards its reuse
+    image_index = static_cast<uint32_t>(current_frame);
+    return vk::Result::eSuccess;
+}
+
 auto Graphics::submit_frame() -> vk::Result {
-    // change swapchain image layout to present
-    vk::ImageMemoryBarrier barrier{};
-//        barrier.setOldLayout(vk::ImageLayout::eUndefined);
-    barrier.setOldLayout(vk::ImageLayout::eColorAttachmentOptimal);
-    barrier.setNewLayout(vk::ImageLayout::ePresentSrcKHR);
-    barrier.setSrcQueueFamilyIndex(context.graphics_queue_family_index);
-    barrier.setDstQueueFamilyIndex(context.present_queue_family_index);
-    barrier.setImage(images[image_index]);
-    barrier.setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
-
-    command_buffers[current_frame].pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags{}, nullptr, nullptr, barrier);
+    LOOP_PROFILE_SCOPE("Submit");
+
+    if (context.headless) {
+        return submit_offscreen_frame();
+    }
+
     command_buffers[current_frame].end();
+    submit_compute();
+
+    // submit command buffer, values of binary semaphores are ignored
+    std::vector<vk::Semaphore> wait_semaphores{image_available_semaphores[current_frame]};
+    std::vector<vk::PipelineStageFlags> wait_stages{vk::PipelineStageFlagBits::eColorAttachmentOutput};
+    std::vector<uint64_t> wait_values{0};
+    add_queue_waits(wait_semaphores, wait_stages, wait_values);
 
-    // submit command buffer
-    vk::PipelineStageFlags wait_stages[] = {
-            vk::PipelineStageFlagBits::eColorAttachmentOutput
+    vk::Semaphore signal_semaphores[] = {
+        render_finished_semaphores[current_frame],
+        frame_timeline
     };
+    uint64_t signal_values[] = {0, get_frame_timeline_value(frame_number)};
+
+    vk::TimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.setWaitSemaphoreValues(wait_values);
+    timeline_info.setSignalSemaphoreValues(signal_values);
 
     vk::SubmitInfo submit_info{};
+    submit_info.setPNext(&timeline_info);
     submit_info.setCommandBufferCount(1);
     submit_info.setPCommandBuffers(&command_buffers[current_frame]);
-    submit_info.setWaitSemaphoreCount(1);
-    submit_info.setPWaitSemaphores(&image_available_semaphores[current_frame]);
-    submit_info.setPWaitDstStageMask(wait_stages);
-    submit_info.setSignalSemaphoreCount(1);
-    submit_info.setPSignalSemaphores(&render_finished_semaphores[current_frame]);
+    submit_info.setWaitSemaphores(wait_semaphores);
+    submit_info.setWaitDstStageMask(wait_stages);
+    submit_info.setSignalSemaphores(signal_semaphores);
 
-    check(context.graphics_queue.submit(1, &submit_info, fences[current_frame]));
+    check(context.graphics_queue.submit(1, &submit_info, vk::Fence{}));
+    submitted_frames[current_frame] = frame_number;
+    frame_pacing.on_frame_submitted(frame_number);
 
     // present image
     vk::PresentInfoKHR present_info{};
@@ -183,10 +402,16 @@ auto Graphics::submit_frame() -> vk::Result {
     present_info.setPSwapchains(&swapchain);
     present_info.setPImageIndices(&image_index);
 
-    current_frame = (current_frame + 1) % maxFramesInFlight;
+    current_frame = (current_frame + 1) % frame_pacing.get_frames_in_flight();
+    frame_number += 1;
 
-    vk::Result result = context.present_queue.presentKHR(&present_info);
+    vk::Result result{};
+    {
+        LOOP_PROFILE_SCOPE("Present");
+        result = context.present_queue.presentKHR(&present_info);
+    }
     if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
+        swapchain_outdated = true;
         recreate_swapchain();
     } else if (result != vk::Result::eSuccess) {
         throw std::runtime_error(vk::to_string(result));
@@ -194,18 +419,111 @@ auto Graphics::submit_frame() -> vk::Result {
     return result;
 }
 
+void Graphics::submit_compute() {
+    submitted_compute_values[current_frame] = 0;
+    if (!compute_recorded) {
+        return;
+    }
+    compute_recorded = false;
+
+    // the compute work of this frame overlaps with the graphics work of the previous one unless it shares resources with it
+    std::vector<vk::Semaphore> wait_semaphores{};
+    std::vector<vk::PipelineStageFlags> wait_stages{};
+    std::vector<uint64_t> wait_values{};
+    if (frame_graph.get_compute_frame_wait_stages() && frame_number > 0) {
+        wait_semaphores.push_back(frame_timeline);
+        wait_stages.push_back(frame_graph.get_compute_frame_wait_stages());
+        wait_values.push_back(get_frame_timeline_value(frame_number - 1));
+    }
+
+    compute_timeline_value = get_frame_timeline_value(frame_number);
+
+    vk::TimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.setWaitSemaphoreValues(wait_values);
+    timeline_info.setSignalSemaphoreValueCount(1);
+    timeline_info.setPSignalSemaphoreValues(&compute_timeline_value);
+
+    vk::SubmitInfo submit_info{};
+    submit_info.setPNext(&timeline_info);
+    submit_info.setCommandBufferCount(1);
+    submit_info.setPCommandBuffers(&compute_command_buffers[current_frame]);
+    submit_info.setWaitSemaphores(wait_semaphores);
+    submit_info.setWaitDstStageMask(wait_stages);
+    submit_info.setSignalSemaphoreCount(1);
+    submit_info.setPSignalSemaphores(&compute_timeline);
+
+    check(context.compute_queue.submit(1, &submit_info, vk::Fence{}));
+    submitted_compute_values[current_frame] = compute_timeline_value;
+    compute_submitted = true;
+}
+
+void Graphics::add_queue_waits(std::vector<vk::Semaphore>& semaphores, std::vector<vk::PipelineStageFlags>& stages, std::vector<uint64_t>& values) {
+    if (compute_submitted && frame_graph.get_compute_wait_stages()) {
+        semaphores.push_back(compute_timeline);
+        stages.push_back(frame_graph.get_compute_wait_stages());
+        values.push_back(compute_timeline_value);
+    }
+    compute_submitted = false;
+
+    // uploads flushed at the beginning of the frame
+    if (transfer_wait_stages) {
+        semaphores.push_back(transfer_queue.get_timeline());
+        stages.push_back(transfer_wait_stages);
+        values.push_back(transfer_queue.get_upload_value());
+    }
+    transfer_wait_stages = {};
+}
+
+auto Graphics::submit_offscreen_frame() -> vk::Result {
+    frame_readback.record(command_buffers[current_frame], current_frame, frame_number, images[image_index]);
+    command_buffers[current_frame].end();
+    submit_compute();
+
+    std::vector<vk::Semaphore> wait_semaphores{};
+    std::vector<vk::PipelineStageFlags> wait_stages{};
+    std::vector<uint64_t> wait_values{};
+    add_queue_waits(wait_semaphores, wait_stages, wait_values);
+
+    auto signal_value = get_frame_timeline_value(frame_number);
+
+    vk::TimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.setWaitSemaphoreValues(wait_values);
+    timeline_info.setSignalSemaphoreValueCount(1);
+    timeline_info.setPSignalSemaphoreValues(&signal_value);
+
+    vk::SubmitInfo submit_info{};
+    submit_info.setPNext(&timeline_info);
+    submit_info.setCommandBufferCount(1);
+    submit_info.setPCommandBuffers(&command_buffers[current_frame]);
+    submit_info.setWaitSemaphores(wait_semaphores);
+    submit_info.setWaitDstStageMask(wait_stages);
+    submit_info.setSignalSemaphoreCount(1);
+    submit_info.setPSignalSemaphores(&frame_timeline);
+
+    check(context.graphics_queue.submit(1, &submit_info, vk::Fence{}));
+    frame_readback.submit(current_frame, frame_timeline, signal_value);
+    submitted_frames[current_frame] = frame_number;
+    frame_pacing.on_frame_submitted(frame_number);
+
+    current_frame = (current_frame + 1) % frame_pacing.get_frames_in_flight();
+    frame_number += 1;
+    return vk::Result::eSuccess;
+}
+
 void Graphics::create_surface() {
     glfwCreateWindowSurface(context.instance, Application::get_instance()->get_window().get_native_handle(), nullptr, reinterpret_cast<VkSurfaceKHR *>(&surface));
 }
 
-void Graphics::create_swapchain() {
+void Graphics::create_swapchain(vk::SwapchainKHR old_swapchain) {
+    int width = 0, height = 0;
+    Application::get_instance()->get_window().get_framebuffer_size(width, height);
+
     auto capabilities = context.physical_device.getSurfaceCapabilitiesKHR(surface);
-    surface_extent = select_surface_extent(vk::Extent2D{0, 0}, capabilities);
+    surface_extent = select_surface_extent(vk::Extent2D{static_cast<uint32_t>(width), static_cast<uint32_t>(height)}, capabilities);
 
-    min_image_count = 3;
-    if (capabilities.maxImageCount > 0 && min_image_count > capabilities.maxImageCount) {
-        min_image_count = capabilities.maxImageCount;
-    }
+    auto present_mode = frame_pacing.select_present_mode(context.physical_device.getSurfacePresentModesKHR(surface));
+    min_image_count = frame_pacing.select_image_count(present_mode, capabilities);
+    spdlog::info("Swapchain: {}x{}, {} images, {} present mode", surface_extent.width, surface_extent.height, min_image_count, vk::to_string(present_mode));
 
     auto queue_family_indices = std::set{
         context.graphics_queue_family_index,
@@ -219,7 +537,8 @@ void Graphics::create_swapchain() {
     create_info.setImageColorSpace(vk::ColorSpaceKHR::eSrgbNonlinear);
     create_info.setImageExtent(surface_extent);
     create_info.setImageArrayLayers(1);
-    create_info.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment);
+    // the upscaled scene is blitted into the swapchain image
+    create_info.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst);
     if (queue_family_indices.size() > 1) {
         create_info.setImageSharingMode(vk::SharingMode::eConcurrent);
         create_info.setQueueFamilyIndices(queue_family_indices);
@@ -228,9 +547,9 @@ void Graphics::create_swapchain() {
     }
     create_info.setPreTransform(capabilities.currentTransform);
     create_info.setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque);
-    create_info.setPresentMode(vk::PresentModeKHR::eFifo);
+    create_info.setPresentMode(present_mode);
     create_info.setClipped(true);
-    create_info.setOldSwapchain(nullptr);
+    create_info.setOldSwapchain(old_swapchain);
 
     swapchain = context.device.createSwapchainKHR(create_info);
     images = context.device.getSwapchainImagesKHR(swapchain);
@@ -247,46 +566,162 @@ void Graphics::create_swapchain() {
     }
 }
 
-void Graphics::recreate_swapchain() {
-    auto window = Application::get_instance()->get_window().get_native_handle();
+void Graphics::create_offscreen_images() {
+    int width = 0, height = 0;
+    Application::get_instance()->get_window().get_framebuffer_size(width, height);
+
+    surface_extent = vk::Extent2D{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    min_image_count = static_cast<uint32_t>(maxFramesInFlight);
+
+    images.resize(maxFramesInFlight);
+    views.resize(maxFramesInFlight);
+    offscreen_allocations.resize(maxFramesInFlight);
+    for (size_t i = 0; i < maxFramesInFlight; i++) {
+        vk::ImageCreateInfo image_create_info{};
+        image_create_info.setImageType(vk::ImageType::e2D);
+        image_create_info.setFormat(vk::Format::eB8G8R8A8Unorm);
+        image_create_info.setExtent({surface_extent.width, surface_extent.height, 1});
+        image_create_info.setMipLevels(1);
+        image_create_info.setArrayLayers(1);
+        image_create_info.setSamples(vk::SampleCountFlagBits::e1);
+        image_create_info.setTiling(vk::ImageTiling::eOptimal);
+        image_create_info.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst);
+
+        VmaAllocationCreateInfo alloc_info{};
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        vmaCreateImage(
+            context.allocator,
+            reinterpret_cast<const VkImageCreateInfo *>(&image_create_info),
+            &alloc_info,
+            reinterpret_cast<VkImage *>(&images[i]),
+            &offscreen_allocations[i],
+            nullptr
+        );
+        track_allocation(MemoryCategory::Texture, offscreen_allocations[i]);
+
+        vk::ImageViewCreateInfo view_create_info{};
+        view_create_info.setImage(images[i]);
+        view_create_info.setViewType(vk::ImageViewType::e2D);
+        view_create_info.setFormat(vk::Format::eB8G8R8A8Unorm);
+        view_create_info.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+
+        views[i] = context.device.createImageView(view_create_info);
+    }
+    spdlog::info("Offscreen target: {}x{}, {} images", surface_extent.width, surface_extent.height, images.size());
+}
 
+auto Graphics::recreate_swapchain() -> bool {
+    // a minimized window has no area to present to, keep the old swapchain until it is restored
     int width = 0, height = 0;
-    glfwGetFramebufferSize(window, &width, &height);
-    while (width == 0 || height == 0) {
-        glfwWaitEvents();
-        glfwGetFramebufferSize(window, &width, &height);
+    Application::get_instance()->get_window().get_framebuffer_size(width, height);
+    if (width == 0 || height == 0) {
+        swapchain_outdated = true;
+        return false;
     }
 
-    // wait idle
-    context.device.waitIdle();
+    auto old_swapchain = swapchain;
+    retire_swapchain();
 
-    for (size_t i = 0; i < views.size(); i++) {
-        context.device.destroyImageView(views[i]);
-        context.device.destroyImageView(depth_views[i]);
-        context.device.destroyFramebuffer(default_framebuffers[i]);
+    create_swapchain(old_swapchain);
+    create_default_framebuffers();
+
+    // the old swapchain is retired by the create call, it is destroyed with its images once the frames presenting from it are done
+    defer_release([&context = context, old_swapchain] {
+        context.device.destroySwapchainKHR(old_swapchain);
+    });
+
+    swapchain_outdated = false;
+    frame_graph_dirty = true;
+    return true;
+}
+
+void Graphics::retire_swapchain() {
+    defer_release([&context = context, views = std::move(views), depth_image = depth_image, depth_view = depth_view, depth_allocation = depth_allocation, framebuffers = std::move(ui_framebuffers)] {
+        for (size_t i = 0; i < views.size(); i++) {
+            context.device.destroyImageView(views[i]);
+            context.device.destroyFramebuffer(framebuffers[i]);
+        }
+        context.device.destroyImageView(depth_view);
+        untrack_allocation(MemoryCategory::Depth, depth_allocation);
+        vmaDestroyImage(context.allocator, depth_image, depth_allocation);
+    });
+    defer_release([&context = context, scene_image = scene_image, scene_view = scene_view, scene_allocation = scene_allocation, framebuffer = default_framebuffer] {
+        context.device.destroyFramebuffer(framebuffer);
+        context.device.destroyImageView(scene_view);
+        untrack_allocation(MemoryCategory::Texture, scene_allocation);
+        vmaDestroyImage(context.allocator, scene_image, scene_allocation);
+    });
+
+    images.clear();
+    views.clear();
+    depth_image = nullptr;
+    depth_view = nullptr;
+    depth_allocation = nullptr;
+    scene_image = nullptr;
+    scene_view = nullptr;
+    scene_allocation = nullptr;
+    default_framebuffer = nullptr;
+    ui_framebuffers.clear();
+}
+
+void Graphics::defer_release(std::function<void()> function) {
+    // the object may be referenced by the frame being recorded and all frames submitted before it
+    pending_releases.emplace_back(PendingRelease{frame_number, std::move(function)});
+}
+
+auto Graphics::query_completed_frame_count() -> uint64_t {
+    auto graphics_value = context.device.getSemaphoreCounterValue(frame_timeline);
+    auto compute_value = context.device.getSemaphoreCounterValue(compute_timeline);
 
-        vmaDestroyImage(context.allocator, depth_images[i], depth_allocations[i]);
+    // a frame whose compute work is still running is not complete, even when its graphics work is
+    auto completed = graphics_value;
+    for (size_t i = 0; i < submitted_frames.size(); i++) {
+        if (submitted_frames[i] != std::numeric_limits<uint64_t>::max() && submitted_compute_values[i] > compute_value) {
+            completed = std::min(completed, submitted_frames[i]);
+        }
     }
+    return completed;
+}
 
-    context.device.destroySwapchainKHR(swapchain);
+void Graphics::update_completed_frames(uint64_t timeline_value) {
+    // the timeline value is the number of frames that have finished
+    for (auto frame = completed_frame_count; frame < timeline_value; frame++) {
+        frame_pacing.on_frame_completed(frame);
+    }
+    completed_frame_count = std::max(completed_frame_count, timeline_value);
+}
 
-    create_swapchain();
-    create_default_framebuffers();
+void Graphics::flush_released_objects(bool all) {
+    while (!pending_releases.empty()) {
+        auto& release = pending_releases.front();
+        if (!all && release.frame_number >= completed_frame_count) {
+            break;
+        }
+        release.function();
+        pending_releases.pop_front();
+    }
 }
 
 void Graphics::create_sync_objects() {
     image_available_semaphores.resize(maxFramesInFlight);
     render_finished_semaphores.resize(maxFramesInFlight);
-    fences.resize(maxFramesInFlight);
+    submitted_frames.resize(maxFramesInFlight, std::numeric_limits<uint64_t>::max());
+    submitted_compute_values.resize(maxFramesInFlight, 0);
+
+    vk::SemaphoreTypeCreateInfo timeline_create_info{};
+    timeline_create_info.setSemaphoreType(vk::SemaphoreType::eTimeline);
+    timeline_create_info.setInitialValue(0);
+
+    vk::SemaphoreCreateInfo timeline_semaphore_create_info{};
+    timeline_semaphore_create_info.setPNext(&timeline_create_info);
+    frame_timeline = context.device.createSemaphore(timeline_semaphore_create_info);
+    compute_timeline = context.device.createSemaphore(timeline_semaphore_create_info);
 
     for (size_t i = 0; i < maxFramesInFlight; i++) {
         vk::SemaphoreCreateInfo semaphore_create_info{};
         image_available_semaphores[i] = context.device.createSemaphore(semaphore_create_info);
         render_finished_semaphores[i] = context.device.createSemaphore(semaphore_create_info);
-
-        vk::FenceCreateInfo fence_create_info{};
-        fence_create_info.setFlags(vk::FenceCreateFlagBits::eSignaled);
-        fences[i] = context.device.createFence(fence_create_info);
     }
 }
 
@@ -299,6 +734,15 @@ void Graphics::create_command_pools() {
     for (size_t i = 0; i < maxFramesInFlight; i++) {
         command_pools[i] = context.device.createCommandPool(pool_create_info);
     }
+
+    vk::CommandPoolCreateInfo compute_pool_create_info{};
+    compute_pool_create_info.setQueueFamilyIndex(context.compute_queue_family_index);
+    compute_pool_create_info.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+
+    compute_command_pools.resize(maxFramesInFlight);
+    for (size_t i = 0; i < maxFramesInFlight; i++) {
+        compute_command_pools[i] = context.device.createCommandPool(compute_pool_create_info);
+    }
 }
 
 void Graphics::create_command_buffers() {
@@ -308,6 +752,9 @@ void Graphics::create_command_buffers() {
         alloc_info.setLevel(vk::CommandBufferLevel::ePrimary);
         alloc_info.setCommandBufferCount(1);
         command_buffers.emplace_back(context.device.allocateCommandBuffers(alloc_info).front());
+
+        alloc_info.setCommandPool(compute_command_pools[i]);
+        compute_command_buffers.emplace_back(context.device.allocateCommandBuffers(alloc_info).front());
     }
 }
 
@@ -375,7 +822,8 @@ void Graphics::create_default_render_pass() {
     depth_attachment.setFormat(context.depth_format);
     depth_attachment.setSamples(vk::SampleCountFlagBits::e1);
     depth_attachment.setLoadOp(vk::AttachmentLoadOp::eClear);
-    depth_attachment.setStoreOp(vk::AttachmentStoreOp::eDontCare);
+    // the depth is only kept for the depth pyramid
+    depth_attachment.setStoreOp(depth_pyramid_enabled ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare);
     depth_attachment.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare);
     depth_attachment.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare);
     depth_attachment.setInitialLayout(vk::ImageLayout::eUndefined);
@@ -406,56 +854,315 @@ void Graphics::create_default_render_pass() {
     default_render_pass = context.device.createRenderPass(render_pass_create_info);
 }
 
-void Graphics::create_default_framebuffers() {
-    depth_views.resize(views.size());
-    depth_images.resize(views.size());
-    depth_allocations.resize(views.size());
-    default_framebuffers.resize(views.size());
+void Graphics::create_ui_render_pass() {
+    // the swapchain image already holds the upscaled scene
+    vk::AttachmentDescription color_attachment{};
+    color_attachment.setFormat(vk::Format::eB8G8R8A8Unorm);
+    color_attachment.setSamples(vk::SampleCountFlagBits::e1);
+    color_attachment.setLoadOp(vk::AttachmentLoadOp::eLoad);
+    color_attachment.setStoreOp(vk::AttachmentStoreOp::eStore);
+    color_attachment.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare);
+    color_attachment.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare);
+    color_attachment.setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal);
+    color_attachment.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
-    for (size_t i = 0; i < views.size(); i++) {
-        vk::ImageCreateInfo image_create_info{};
-        image_create_info.setImageType(vk::ImageType::e2D);
-        image_create_info.setFormat(context.depth_format);
-        image_create_info.setExtent({surface_extent.width, surface_extent.height, 1});
-        image_create_info.setMipLevels(1);
-        image_create_info.setArrayLayers(1);
-        image_create_info.setSamples(vk::SampleCountFlagBits::e1);
-        image_create_info.setTiling(vk::ImageTiling::eOptimal);
-        image_create_info.setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment);
+    vk::AttachmentReference color_attachment_ref{};
+    color_attachment_ref.setAttachment(0);
+    color_attachment_ref.setLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
-        VmaAllocationCreateInfo alloc_info{};
+    vk::SubpassDescription subpass{};
+    subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics);
+    subpass.setColorAttachmentCount(1);
+    subpass.setPColorAttachments(&color_attachment_ref);
+
+    vk::RenderPassCreateInfo render_pass_create_info{};
+    render_pass_create_info.setAttachmentCount(1);
+    render_pass_create_info.setPAttachments(&color_attachment);
+    render_pass_create_info.setSubpassCount(1);
+    render_pass_create_info.setPSubpasses(&subpass);
+
+    ui_render_pass = context.device.createRenderPass(render_pass_create_info);
+}
+
+void Graphics::create_default_framebuffers() {
+    vk::ImageCreateInfo image_create_info{};
+    image_create_info.setImageType(vk::ImageType::e2D);
+    image_create_info.setFormat(context.depth_format);
+    image_create_info.setExtent({surface_extent.width, surface_extent.height, 1});
+    image_create_info.setMipLevels(1);
+    image_create_info.setArrayLayers(1);
+    image_create_info.setSamples(vk::SampleCountFlagBits::e1);
+    image_create_info.setTiling(vk::ImageTiling::eOptimal);
+
+    VmaAllocationCreateInfo alloc_info{};
+    if (depth_pyramid_enabled) {
+        image_create_info.setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled);
         alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    } else {
+        // the depth never leaves the render pass, tile based GPUs keep it in on-chip memory
+        image_create_info.setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment);
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+    }
 
-        vmaCreateImage(
+    auto result = vmaCreateImage(
+        context.allocator,
+        reinterpret_cast<const VkImageCreateInfo *>(&image_create_info),
+        &alloc_info,
+        reinterpret_cast<VkImage *>(&depth_image),
+        &depth_allocation,
+        nullptr
+    );
+    if (result != VK_SUCCESS && alloc_info.usage == VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED) {
+        // there is no lazily allocated memory type
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        result = vmaCreateImage(
             context.allocator,
             reinterpret_cast<const VkImageCreateInfo *>(&image_create_info),
             &alloc_info,
-            reinterpret_cast<VkImage *>(&depth_images[i]),
-            &depth_allocations[i],
+            reinterpret_cast<VkImage *>(&depth_image),
+            &depth_allocation,
             nullptr
         );
+    }
+    check(vk::Result(result));
+    track_allocation(MemoryCategory::Depth, depth_allocation);
+
+    vk::ImageViewCreateInfo image_view_create_info{};
+    image_view_create_info.setImage(depth_image);
+    image_view_create_info.setViewType(vk::ImageViewType::e2D);
+    image_view_create_info.setFormat(context.depth_format);
+    image_view_create_info.setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1});
+
+    depth_view = context.device.createImageView(image_view_create_info);
+
+    vk::ImageCreateInfo scene_create_info{};
+    scene_create_info.setImageType(vk::ImageType::e2D);
+    scene_create_info.setFormat(vk::Format::eB8G8R8A8Unorm);
+    scene_create_info.setExtent({surface_extent.width, surface_extent.height, 1});
+    scene_create_info.setMipLevels(1);
+    scene_create_info.setArrayLayers(1);
+    scene_create_info.setSamples(vk::SampleCountFlagBits::e1);
+    scene_create_info.setTiling(vk::ImageTiling::eOptimal);
+    scene_create_info.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc);
+
+    VmaAllocationCreateInfo scene_alloc_info{};
+    scene_alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    check(vk::Result(vmaCreateImage(
+        context.allocator,
+        reinterpret_cast<const VkImageCreateInfo *>(&scene_create_info),
+        &scene_alloc_info,
+        reinterpret_cast<VkImage *>(&scene_image),
+        &scene_allocation,
+        nullptr
+    )));
+    track_allocation(MemoryCategory::Texture, scene_allocation);
+
+    vk::ImageViewCreateInfo scene_view_create_info{};
+    scene_view_create_info.setImage(scene_image);
+    scene_view_create_info.setViewType(vk::ImageViewType::e2D);
+    scene_view_create_info.setFormat(vk::Format::eB8G8R8A8Unorm);
+    scene_view_create_info.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+
+    scene_view = context.device.createImageView(scene_view_create_info);
+
+    vk::ImageView scene_attachments[2] { scene_view, depth_view };
+
+    vk::FramebufferCreateInfo framebuffer_create_info{};
+    framebuffer_create_info.setRenderPass(default_render_pass);
+    framebuffer_create_info.setAttachments(scene_attachments);
+    framebuffer_create_info.setWidth(surface_extent.width);
+    framebuffer_create_info.setHeight(surface_extent.height);
+    framebuffer_create_info.setLayers(1);
+
+    default_framebuffer = context.device.createFramebuffer(framebuffer_create_info);
+
+    ui_framebuffers.resize(views.size());
+    for (size_t i = 0; i < views.size(); i++) {
+        vk::FramebufferCreateInfo ui_framebuffer_create_info{};
+        ui_framebuffer_create_info.setRenderPass(ui_render_pass);
+        ui_framebuffer_create_info.setAttachmentCount(1);
+        ui_framebuffer_create_info.setPAttachments(&views[i]);
+        ui_framebuffer_create_info.setWidth(surface_extent.width);
+        ui_framebuffer_create_info.setHeight(surface_extent.height);
+        ui_framebuffer_create_info.setLayers(1);
+
+        ui_framebuffers[i] = context.device.createFramebuffer(ui_framebuffer_create_info);
+    }
+}
+
+void Graphics::build_frame_graph() {
+    // transient attachments of the old graph are released once the frames using them have finished
+    frame_graph.reset();
+
+    static constexpr auto swapchain_initial_access = RenderGraphAccess{
+        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        vk::AccessFlags{},
+        vk::ImageLayout::eUndefined
+    };
+    // the depth is shared by all frames, the previous frame may still test against it or build its pyramid
+    static constexpr auto depth_initial_access = RenderGraphAccess{
+        vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader,
+        vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+        vk::ImageLayout::eUndefined
+    };
 
-        vk::ImageViewCreateInfo image_view_create_info{};
-        image_view_create_info.setImage(depth_images[i]);
-        image_view_create_info.setViewType(vk::ImageViewType::e2D);
-        image_view_create_info.setFormat(context.depth_format);
-        image_view_create_info.setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1});
+    // like the depth the scene target is shared, the previous frame may still render into it or upscale it
+    static constexpr auto scene_initial_access = RenderGraphAccess{
+        vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer,
+        vk::AccessFlagBits::eColorAttachmentWrite,
+        vk::ImageLayout::eUndefined
+    };
 
-        depth_views[i] = context.device.createImageView(image_view_create_info);
+    // offscreen images end the frame ready to be copied by the readback
+    auto swapchain_final_access = context.headless ? RenderGraphAccesses::transfer_read : RenderGraphAccesses::present;
+    swapchain_resource = frame_graph.import_image("swapchain", vk::Format::eB8G8R8A8Unorm, surface_extent, swapchain_initial_access, swapchain_final_access);
+    scene_resource = frame_graph.import_image("scene", vk::Format::eB8G8R8A8Unorm, surface_extent, scene_initial_access, RenderGraphAccess{});
+    depth_resource = frame_graph.import_image("depth", context.depth_format, surface_extent, depth_initial_access, RenderGraphAccess{});
+
+    // without occlusion culling the pyramid is never built, a single texel is kept for the descriptors that sample it
+    auto pyramid_depth_extent = depth_pyramid_enabled ? surface_extent : vk::Extent2D{1, 1};
+    if (depth_pyramid.get_depth_extent() != pyramid_depth_extent) {
+        depth_pyramid.resize(pyramid_depth_extent);
+
+        // the first pass that reads the pyramid may run on the compute queue ahead of the graphics work of the frame
+        auto cmd = begin_single_time_commands();
+        depth_pyramid.prepare(cmd);
+        submit_single_time_commands(cmd);
+    }
 
-        std::vector<vk::ImageView> attachments{};
-        attachments.push_back(views[i]);
-        attachments.push_back(depth_views[i]);
+    // the pyramid keeps its contents across frames, the graph hands it over from the pass that builds it to the
+    // passes of the next frame that read it, on whichever queue they run
+    depth_pyramid_resource = frame_graph.import_image("depth_pyramid", vk::Format::eR32Sfloat, depth_pyramid.get_extent(), RenderGraphAccess{}, RenderGraphAccess{});
 
-        vk::FramebufferCreateInfo framebuffer_create_info{};
-        framebuffer_create_info.setRenderPass(default_render_pass);
-        framebuffer_create_info.setAttachments(attachments);
-        framebuffer_create_info.setWidth(surface_extent.width);
-        framebuffer_create_info.setHeight(surface_extent.height);
-        framebuffer_create_info.setLayers(1);
+    auto queue = EventSystem::get_global_event_queue();
+    queue->send_event(FrameGraphSetupEvent{frame_graph, FrameGraphStage::BeforeMainPass, scene_resource, depth_resource});
 
-        default_framebuffers[i] = context.device.createFramebuffer(framebuffer_create_info);
+    frame_graph.add_pass("main", RenderGraphQueue::Graphics, [this](RenderGraphBuilder& builder) {
+        builder.write(scene_resource, RenderGraphAccesses::color_attachment);
+        builder.write(depth_resource, RenderGraphAccesses::depth_attachment);
+    }, [this](vk::CommandBuffer cmd, RenderGraph& graph) {
+        record_main_pass(cmd);
+    });
+
+    if (depth_pyramid_enabled) {
+        depth_pyramid.add_pass(frame_graph, depth_resource, depth_pyramid_resource);
+    }
+
+    queue->send_event(FrameGraphSetupEvent{frame_graph, FrameGraphStage::AfterMainPass, scene_resource, depth_resource});
+
+    frame_graph.add_pass("upscale", RenderGraphQueue::Graphics, [this](RenderGraphBuilder& builder) {
+        builder.read(scene_resource, RenderGraphAccesses::transfer_read);
+        builder.write(swapchain_resource, RenderGraphAccesses::transfer_write);
+    }, [this](vk::CommandBuffer cmd, RenderGraph& graph) {
+        record_upscale_pass(cmd, graph);
+    });
+
+    frame_graph.add_pass("ui", RenderGraphQueue::Graphics, [this](RenderGraphBuilder& builder) {
+        builder.write(swapchain_resource, RenderGraphAccesses::color_attachment);
+    }, [this](vk::CommandBuffer cmd, RenderGraph& graph) {
+        record_ui_pass(cmd);
+    });
+
+    frame_graph.compile(surface_extent);
+    frame_graph_dirty = false;
+}
+
+void Graphics::record_main_pass(vk::CommandBuffer cmd) {
+    // the viewport of the secondary command buffers follows the render area
+    auto rect = vk::Rect2D{{0, 0}, render_extent};
+
+    std::array<vk::ClearValue, 2> clear_values{};
+    clear_values[0].setColor(vk::ClearColorValue{}.setFloat32({0.0f, 0.0f, 0.0f, 1.0f}));
+    clear_values[1].setDepthStencil(vk::ClearDepthStencilValue{}.setDepth(1.0f).setStencil(0));
+
+    // begin render pass
+    vk::RenderPassBeginInfo render_pass_begin_info{};
+    render_pass_begin_info.setRenderPass(default_render_pass);
+    render_pass_begin_info.setFramebuffer(default_framebuffer);
+    render_pass_begin_info.setRenderArea(rect);
+    render_pass_begin_info.setClearValues(clear_values);
+    cmd.beginRenderPass(render_pass_begin_info, vk::SubpassContents::eSecondaryCommandBuffers);
+
+    command_recorder.begin_pass(current_frame, default_render_pass, default_framebuffer, rect);
+
+    auto queue = EventSystem::get_global_event_queue();
+    {
+        LOOP_PROFILE_SCOPE("ParallelDrawEvent");
+        queue->send_event(ParallelDrawEvent{command_recorder});
+    }
+    {
+        LOOP_PROFILE_SCOPE("RenderQueueEvent");
+        queue->send_event(RenderQueueEvent{render_queue});
+        render_queue.sort();
+        render_queue.batch(instance_buffer, current_frame);
+    }
+    for (size_t begin = 0; begin < render_queue.size(); begin += render_queue_chunk_size) {
+        command_recorder.record([this, begin](vk::CommandBuffer cmd) {
+            GpuProfileScope scope(gpu_profiler, cmd, render_queue_scope);
+            render_queue.execute(cmd, begin, begin + render_queue_chunk_size);
+        });
+    }
+
+    auto draw_cmd = command_recorder.begin_secondary(0);
+    {
+        LOOP_PROFILE_SCOPE("BeforeDrawEvent");
+        GpuProfileScope scope(gpu_profiler, draw_cmd, before_draw_scope);
+        queue->send_event(BeforeDrawEvent{draw_cmd});
     }
+    {
+        LOOP_PROFILE_SCOPE("DrawEvent");
+        GpuProfileScope scope(gpu_profiler, draw_cmd, draw_scope);
+        queue->send_event(DrawEvent{draw_cmd});
+    }
+    command_recorder.end_secondary(draw_cmd);
+
+    command_recorder.record_tasks();
+    render_queue.clear();
+
+    cmd.executeCommands(command_recorder.end_pass());
+    cmd.endRenderPass();
+}
+
+void Graphics::record_upscale_pass(vk::CommandBuffer cmd, RenderGraph& graph) {
+    GpuProfileScope scope(gpu_profiler, cmd, upscale_scope);
+
+    vk::ImageBlit region{};
+    region.setSrcSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1});
+    region.setSrcOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{static_cast<int32_t>(render_extent.width), static_cast<int32_t>(render_extent.height), 1}});
+    region.setDstSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1});
+    region.setDstOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{static_cast<int32_t>(surface_extent.width), static_cast<int32_t>(surface_extent.height), 1}});
+
+    // a copy at full resolution stays sharp
+    auto filter = render_extent == surface_extent ? vk::Filter::eNearest : vk::Filter::eLinear;
+    cmd.blitImage(graph.get_image(scene_resource), vk::ImageLayout::eTransferSrcOptimal, graph.get_image(swapchain_resource), vk::ImageLayout::eTransferDstOptimal, region, filter);
+}
+
+void Graphics::record_ui_pass(vk::CommandBuffer cmd) {
+    auto rect = vk::Rect2D{{0, 0}, surface_extent};
+
+    vk::RenderPassBeginInfo render_pass_begin_info{};
+    render_pass_begin_info.setRenderPass(ui_render_pass);
+    render_pass_begin_info.setFramebuffer(ui_framebuffers[image_index]);
+    render_pass_begin_info.setRenderArea(rect);
+    cmd.beginRenderPass(render_pass_begin_info, vk::SubpassContents::eInline);
+
+    vk::Viewport viewport{};
+    viewport.setWidth(static_cast<float>(surface_extent.width));
+    viewport.setHeight(static_cast<float>(surface_extent.height));
+    viewport.setMinDepth(0.0f);
+    viewport.setMaxDepth(1.0f);
+
+    cmd.setScissor(0, rect);
+    cmd.setViewport(0, viewport);
+
+    {
+        LOOP_PROFILE_SCOPE("AfterDrawEvent");
+        GpuProfileScope scope(gpu_profiler, cmd, after_draw_scope);
+        EventSystem::get_global_event_queue()->send_event(AfterDrawEvent{cmd});
+    }
+
+    cmd.endRenderPass();
 }
 
 void LoopEngine::Graphics::bind_global_descriptor_sets(vk::CommandBuffer cmd, const Material& material, int set) {
@@ -1,14 +1,55 @@
 #pragma once
 
+#include "RenderGraph.hpp"
+#include "RenderQueue.hpp"
+#include "DepthPyramid.hpp"
+#include "FramePacing.hpp"
+#include "FrameReadback.hpp"
+#include "DynamicResolution.hpp"
+#include "GpuProfiler.hpp"
+#include "TransferQueue.hpp"
+#include "CommandRecorder.hpp"
+#include "InstanceBuffer.hpp"
+#include "DescriptorAllocator.hpp"
 #include "LoopEngine/Core/Singleton.hpp"
 
 #include "vk_mem_alloc.h"
 #include <vulkan/vulkan.hpp>
 
+#include <deque>
+#include <functional>
+
 namespace LoopEngine::Graphics {
     struct Context;
     struct Material;
     struct UniformBuffer;
+
+    enum class FrameGraphStage {
+        BeforeMainPass,
+        AfterMainPass
+    };
+
+    // sent while the frame graph is rebuilt, passes added by the handlers run before or after the main pass,
+    // color is the scene target that is upscaled to the swapchain once the passes after the main pass are done
+    struct FrameGraphSetupEvent {
+        RenderGraph& graph;
+        FrameGraphStage stage;
+        RenderGraphResource color;
+        RenderGraphResource depth;
+    };
+
+    // sent from the main pass before anything is drawn, tasks queued on the recorder are recorded
+    // on the job system threads and executed between DrawEvent and AfterDrawEvent
+    struct ParallelDrawEvent {
+        CommandRecorder& recorder;
+    };
+
+    // sent from the main pass after ParallelDrawEvent, the submitted packets are sorted and recorded
+    // in chunks on the job system threads after the tasks queued by ParallelDrawEvent
+    struct RenderQueueEvent {
+        RenderQueue& queue;
+    };
+
     struct Graphics final : LoopEngine::Core::Singleton<Graphics> {
     public:
         Graphics(Context& context);
@@ -29,12 +70,41 @@ namespace LoopEngine::Graphics {
             return min_image_count;
         }
 
+        // renders the scene into the scene target at the dynamic resolution
         [[nodiscard]] auto get_default_render_pass() const -> vk::RenderPass {
             return default_render_pass;
         }
 
+        // draws over the upscaled scene at the resolution of the surface, AfterDrawEvent is sent inside of it
+        [[nodiscard]] auto get_ui_render_pass() const -> vk::RenderPass {
+            return ui_render_pass;
+        }
+
         [[nodiscard]] auto get_current_swapchain_framebuffer() const -> vk::Framebuffer {
-            return default_framebuffers[image_index];
+            return ui_framebuffers[image_index];
+        }
+
+        // the part of the scene target rendered to in the current frame
+        [[nodiscard]] auto get_render_extent() const -> vk::Extent2D {
+            return render_extent;
+        }
+
+        // index of the frame in flight that is currently recorded
+        [[nodiscard]] auto get_current_frame() const -> size_t {
+            return current_frame;
+        }
+
+        [[nodiscard]] auto get_frame_number() const -> uint64_t {
+            return frame_number;
+        }
+
+        // the timeline reaches frame + 1 once all GPU work of that frame has finished
+        [[nodiscard]] auto get_frame_timeline() const -> vk::Semaphore {
+            return frame_timeline;
+        }
+
+        [[nodiscard]] auto get_frame_timeline_value(uint64_t frame) const -> uint64_t {
+            return frame + 1;
         }
 
         [[nodiscard]] auto get_current_frame_command_buffer() const -> vk::CommandBuffer {
@@ -49,56 +119,196 @@ namespace LoopEngine::Graphics {
             return global_descriptor_sets[current_frame];
         }
 
+        // the set is only valid until the end of the current frame, main thread only, tasks recorded on the job
+        // system threads have to allocate their sets before they are queued
+        [[nodiscard]] auto allocate_transient_descriptor_set(vk::DescriptorSetLayout layout) -> vk::DescriptorSet {
+            return descriptor_allocator.allocate(current_frame, layout);
+        }
+
+        [[nodiscard]] auto get_frame_graph() -> RenderGraph& {
+            return frame_graph;
+        }
+
+        [[nodiscard]] auto get_frame_pacing() -> FramePacing& {
+            return frame_pacing;
+        }
+
+        [[nodiscard]] auto get_gpu_profiler() -> GpuProfiler& {
+            return gpu_profiler;
+        }
+
+        // built from the depth of the previous frame, stays cleared to the far plane when it is disabled
+        [[nodiscard]] auto get_depth_pyramid() -> DepthPyramid& {
+            return depth_pyramid;
+        }
+
+        // the depth pyramid imported into the frame graph, valid while the graph is set up
+        [[nodiscard]] auto get_depth_pyramid_resource() const -> RenderGraphResource {
+            return depth_pyramid_resource;
+        }
+
+        [[nodiscard]] auto is_depth_pyramid_enabled() const -> bool {
+            return depth_pyramid_enabled;
+        }
+
+        // the scale of the render extent follows the GPU time of the frames measured by the profiler
+        [[nodiscard]] auto get_dynamic_resolution() -> DynamicResolution& {
+            return dynamic_resolution;
+        }
+
+        // uploads queued here are submitted and acquired by the next frame
+        [[nodiscard]] auto get_transfer_queue() -> TransferQueue& {
+            return transfer_queue;
+        }
+
+        // the frame graph is rebuilt at the beginning of the next frame
+        void invalidate_frame_graph() {
+            frame_graph_dirty = true;
+        }
+
+        // true while the surface has no area, frames are skipped until the window is restored
+        [[nodiscard]] auto is_swapchain_outdated() const -> bool {
+            return swapchain_outdated;
+        }
+
+        // runs the function once every frame that may still use the released objects has finished on the GPU
+        void defer_release(std::function<void()> function);
+
         [[nodiscard]] auto begin_single_time_commands() -> vk::CommandBuffer;
         void submit_single_time_commands(vk::CommandBuffer cmd);
+        // blocks until all GPU work of the frame has finished
+        void wait_for_frame(uint64_t frame);
+        [[nodiscard]] auto is_frame_complete(uint64_t frame) -> bool;
+
+        // waits until the resources of the next frame are free, input should be sampled right after
+        void begin_frame();
         [[nodiscard]] auto setup_frame() -> vk::Result;
+        void execute_frame_graph();
         [[nodiscard]] auto submit_frame() -> vk::Result;
 
     private:
         void create_surface();
-        void create_swapchain();
-        void recreate_swapchain();
+        void create_swapchain(vk::SwapchainKHR old_swapchain);
+        void create_offscreen_images();
+        auto recreate_swapchain() -> bool;
+        void retire_swapchain();
+        auto query_completed_frame_count() -> uint64_t;
+        void update_completed_frames(uint64_t timeline_value);
+        void flush_released_objects(bool all);
         void create_sync_objects();
         void create_command_pools();
         void create_command_buffers();
         void create_default_descriptors();
         void create_default_render_pass();
+        void create_ui_render_pass();
         void create_default_framebuffers();
+        auto acquire_swapchain_image() -> vk::Result;
+        auto acquire_offscreen_image() -> vk::Result;
+        auto submit_offscreen_frame() -> vk::Result;
+        void submit_compute();
+        void add_queue_waits(std::vector<vk::Semaphore>& semaphores, std::vector<vk::PipelineStageFlags>& stages, std::vector<uint64_t>& values);
+        void build_frame_graph();
+        void record_main_pass(vk::CommandBuffer cmd);
+        void record_upscale_pass(vk::CommandBuffer cmd, RenderGraph& graph);
+        void record_ui_pass(vk::CommandBuffer cmd);
 
     private:
+        struct PendingRelease {
+            uint64_t frame_number;
+            std::function<void()> function;
+        };
+
         Context& context;
         size_t maxFramesInFlight = 3;
 
-        std::vector<vk::Fence> fences{};
+        // binary semaphores are still required by acquire and present
+        vk::Semaphore frame_timeline{};
         std::vector<vk::Semaphore> image_available_semaphores{};
         std::vector<vk::Semaphore> render_finished_semaphores{};
 
         uint32_t image_index = 0;
         size_t current_frame = 0;
+        uint64_t frame_number = 0;
+        uint64_t completed_frame_count = 0;
+
+        // the last frame submitted from every frame in flight and the compute value it signalled, zero without compute work
+        std::vector<uint64_t> submitted_frames{};
+        std::vector<uint64_t> submitted_compute_values{};
+        FramePacing frame_pacing{};
 
         uint32_t min_image_count = 0;
 
         std::vector<vk::CommandPool> command_pools{};
         std::vector<vk::CommandBuffer> command_buffers{};
 
+        // async compute passes of the frame graph are recorded here and submitted before the graphics work
+        std::vector<vk::CommandPool> compute_command_pools{};
+        std::vector<vk::CommandBuffer> compute_command_buffers{};
+        vk::Semaphore compute_timeline{};
+        uint64_t compute_timeline_value = 0;
+        bool compute_recorded = false;
+        bool compute_submitted = false;
+
+        TransferQueue transfer_queue{context};
+        vk::PipelineStageFlags transfer_wait_stages{};
+        CommandRecorder command_recorder{context};
+        RenderQueue render_queue{};
+        InstanceBuffer instance_buffer{context};
+        DescriptorAllocator descriptor_allocator{context};
+        GpuProfiler gpu_profiler{context};
+        GpuScopeId frame_scope = 0;
+        GpuScopeId render_queue_scope = 0;
+        GpuScopeId before_draw_scope = 0;
+        GpuScopeId draw_scope = 0;
+        GpuScopeId upscale_scope = 0;
+        GpuScopeId after_draw_scope = 0;
+        uint32_t frame_query = GpuProfiler::invalid_query;
+
         vk::SurfaceKHR surface{};
         vk::SwapchainKHR swapchain{};
+        bool swapchain_outdated = false;
 
         std::vector<vk::Image> images{};
         std::vector<vk::ImageView> views{};
 
-        std::vector<vk::Image> depth_images{};
-        std::vector<vk::ImageView> depth_views{};
-        std::vector<VmaAllocation> depth_allocations{};
+        // owned images that replace the swapchain when running headless
+        std::vector<VmaAllocation> offscreen_allocations{};
+        FrameReadback frame_readback{context, transfer_queue};
+
+        // frames use the depth in submission order, so a single image is shared by all of them
+        vk::Image depth_image{};
+        vk::ImageView depth_view{};
+        VmaAllocation depth_allocation{};
+
+        // the scene is rendered into the top left part of a target of the surface size, so the
+        // scale changes without recreating it, and is then blitted to the swapchain image
+        vk::Image scene_image{};
+        vk::ImageView scene_view{};
+        VmaAllocation scene_allocation{};
+        DynamicResolution dynamic_resolution{};
+        vk::Extent2D render_extent{};
 
         vk::Extent2D surface_extent{};
         vk::RenderPass default_render_pass{};
-        std::vector<vk::Framebuffer> default_framebuffers{};
+        vk::Framebuffer default_framebuffer{};
+        vk::RenderPass ui_render_pass{};
+        std::vector<vk::Framebuffer> ui_framebuffers{};
 
         vk::DescriptorPool global_descriptor_pool{};
         vk::DescriptorSetLayout global_descriptor_set_layout{};
         std::vector<vk::DescriptorSet> global_descriptor_sets{};
         std::vector<std::shared_ptr<UniformBuffer>> global_uniform_buffers;
+
+        RenderGraph frame_graph{context};
+        RenderGraphResource swapchain_resource{};
+        RenderGraphResource scene_resource{};
+        RenderGraphResource depth_resource{};
+        RenderGraphResource depth_pyramid_resource{};
+        bool frame_graph_dirty = true;
+        DepthPyramid depth_pyramid{context};
+        bool depth_pyramid_enabled = true;
+
+        std::deque<PendingRelease> pending_releases{};
     };
 
     extern void bind_global_descriptor_sets(vk::CommandBuffer cmd, const Material& material, int set);
@@ -1,5 +1,7 @@
 #include "IndexBuffer.hpp"
 #include "Context.hpp"
+#include "Graphics.hpp"
+#include "MemoryStats.hpp"
 
 auto LoopEngine::Graphics::create_index_buffer(vk::DeviceSize size) -> std::shared_ptr<IndexBuffer> {
     vk::BufferUsageFlags usage;
@@ -16,6 +18,30 @@ auto LoopEngine::Graphics::create_index_buffer(vk::DeviceSize size) -> std::shar
     VkBuffer handle;
     VmaAllocation allocation;
     vmaCreateBuffer(Context::get_instance()->allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, &handle, &allocation, nullptr);
+    track_allocation(MemoryCategory::Index, allocation);
+
+    auto buffer = std::make_shared<IndexBuffer>();
+    buffer->handle = handle;
+    buffer->allocation = allocation;
+    return buffer;
+}
+
+auto LoopEngine::Graphics::create_static_index_buffer(vk::DeviceSize size) -> std::shared_ptr<IndexBuffer> {
+    vk::BufferUsageFlags usage;
+    usage |= vk::BufferUsageFlagBits::eIndexBuffer;
+    usage |= vk::BufferUsageFlagBits::eTransferDst;
+
+    vk::BufferCreateInfo buffer_info{};
+    buffer_info.setSize(size);
+    buffer_info.setUsage(usage);
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    VkBuffer handle;
+    VmaAllocation allocation;
+    vmaCreateBuffer(Context::get_instance()->allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, &handle, &allocation, nullptr);
+    track_allocation(MemoryCategory::Index, allocation);
 
     auto buffer = std::make_shared<IndexBuffer>();
     buffer->handle = handle;
@@ -24,6 +50,7 @@ auto LoopEngine::Graphics::create_index_buffer(vk::DeviceSize size) -> std::shar
 }
 
 void LoopEngine::Graphics::release_index_buffer(const IndexBuffer &buffer) {
+    untrack_allocation(MemoryCategory::Index, buffer.allocation);
     vmaDestroyBuffer(Context::get_instance()->allocator, buffer.handle, buffer.allocation);
 }
 
@@ -41,3 +68,7 @@ void LoopEngine::Graphics::update_index_buffer(const IndexBuffer &buffer, const
     std::memcpy(map_index_buffer(buffer), data, size);
     unmap_index_buffer(buffer);
 }
+
+void LoopEngine::Graphics::upload_index_buffer(const IndexBuffer &buffer, const void *data, vk::DeviceSize size) {
+    Graphics::get_instance()->get_transfer_queue().upload_buffer(buffer.handle, 0, data, size, vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
+}
@@ -13,10 +13,13 @@ namespace LoopEngine::Graphics {
     };
 
     extern auto create_index_buffer(vk::DeviceSize size) -> std::shared_ptr<IndexBuffer>;
+    // device local buffer that is only written through the transfer queue
+    extern auto create_static_index_buffer(vk::DeviceSize size) -> std::shared_ptr<IndexBuffer>;
     extern void release_index_buffer(const IndexBuffer& buffer);
 
     extern auto map_index_buffer(const IndexBuffer &buffer) -> void*;
     extern void unmap_index_buffer(const IndexBuffer &buffer);
     extern void update_index_buffer(const IndexBuffer &buffer, const void *data, vk::DeviceSize size);
+    extern void upload_index_buffer(const IndexBuffer &buffer, const void *data, vk::DeviceSize size);
 }
 
@@ -0,0 +1,85 @@
+#include "InstanceBuffer.hpp"
+#include "Context.hpp"
+#include "MemoryStats.hpp"
+
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::InstanceBuffer;
+using LoopEngine::Graphics::InstanceAllocation;
+
+InstanceBuffer::InstanceBuffer(Context& context) : context(context) {}
+
+void InstanceBuffer::initialize(size_t frame_count, vk::DeviceSize initial_size) {
+    frames.resize(frame_count);
+    for (auto& frame : frames) {
+        frame.current = create_block(initial_size);
+    }
+}
+
+void InstanceBuffer::terminate() {
+    for (size_t i = 0; i < frames.size(); i++) {
+        reset_frame(i);
+        release_block(frames[i].current);
+    }
+    frames.clear();
+}
+
+void InstanceBuffer::reset_frame(size_t frame) {
+    for (auto& block : frames[frame].retired) {
+        release_block(block);
+    }
+    frames[frame].retired.clear();
+    frames[frame].used = 0;
+}
+
+auto InstanceBuffer::allocate(size_t frame, vk::DeviceSize size) -> InstanceAllocation {
+    auto& frame_blocks = frames[frame];
+
+    auto offset = (frame_blocks.used + alignment - 1) & ~(alignment - 1);
+    if (offset + size > frame_blocks.current.size) {
+        // draws recorded earlier in the frame still reference the old block
+        frame_blocks.retired.push_back(frame_blocks.current);
+        frame_blocks.current = create_block(std::max(frame_blocks.current.size * 2, size));
+        offset = 0;
+    }
+    frame_blocks.used = offset + size;
+
+    InstanceAllocation allocation{};
+    allocation.buffer = frame_blocks.current.buffer;
+    allocation.offset = offset;
+    allocation.data = static_cast<uint8_t*>(frame_blocks.current.mapped) + offset;
+    return allocation;
+}
+
+void InstanceBuffer::flush(size_t frame) {
+    auto& frame_blocks = frames[frame];
+    for (auto& block : frame_blocks.retired) {
+        vmaFlushAllocation(context.allocator, block.allocation, 0, VK_WHOLE_SIZE);
+    }
+    if (frame_blocks.used > 0) {
+        vmaFlushAllocation(context.allocator, frame_blocks.current.allocation, 0, frame_blocks.used);
+    }
+}
+
+auto InstanceBuffer::create_block(vk::DeviceSize size) -> Block {
+    vk::BufferCreateInfo buffer_info{};
+    buffer_info.setSize(size);
+    buffer_info.setUsage(vk::BufferUsageFlagBits::eVertexBuffer);
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+    Block block{};
+    VmaAllocationInfo allocation_info{};
+    vmaCreateBuffer(context.allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, reinterpret_cast<VkBuffer *>(&block.buffer), &block.allocation, &allocation_info);
+    track_allocation(MemoryCategory::Vertex, block.allocation);
+
+    block.mapped = allocation_info.pMappedData;
+    block.size = size;
+    return block;
+}
+
+void InstanceBuffer::release_block(const Block& block) {
+    untrack_allocation(MemoryCategory::Vertex, block.allocation);
+    vmaDestroyBuffer(context.allocator, block.buffer, block.allocation);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+
+    struct InstanceAllocation {
+        vk::Buffer buffer{};
+        vk::DeviceSize offset = 0;
+        void* data = nullptr;
+    };
+
+    // Host visible vertex buffers that receive the instance data of merged draws, every frame in flight owns one.
+    // When a buffer overflows a larger one replaces it, the old buffer stays alive until the frame is reused.
+    struct InstanceBuffer {
+        explicit InstanceBuffer(Context& context);
+
+        void initialize(size_t frame_count, vk::DeviceSize initial_size);
+        void terminate();
+
+        // must only be called once the GPU has finished the frame
+        void reset_frame(size_t frame);
+
+        auto allocate(size_t frame, vk::DeviceSize size) -> InstanceAllocation;
+
+        // makes the data written into the frame visible to the GPU
+        void flush(size_t frame);
+
+    private:
+        static constexpr vk::DeviceSize alignment = 16;
+
+        struct Block {
+            vk::Buffer buffer{};
+            VmaAllocation allocation{};
+            void* mapped = nullptr;
+            vk::DeviceSize size = 0;
+        };
+
+        struct FrameBlocks {
+            Block current{};
+            vk::DeviceSize used = 0;
+            std::vector<Block> retired{};
+        };
+
+        auto create_block(vk::DeviceSize size) -> Block;
+        void release_block(const Block& block);
+
+        Context& context;
+        std::vector<FrameBlocks> frames{};
+    };
+}
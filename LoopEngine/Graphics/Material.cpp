@@ -7,11 +7,15 @@
 #include "LoopEngine/Asset/AssetSystem.hpp"
 #include "LoopEngine/VulkanEnums.hpp"
 
+#include <atomic>
+
 using LoopEngine::Asset::AssetSystem;
 using LoopEngine::Vulkan::get_format_from_string;
 using LoopEngine::Vulkan::get_blend_op_from_string;
 using LoopEngine::Vulkan::get_blend_factor_from_string;
 
+static std::atomic<uint32_t> next_material_id{1};
+
 auto LoopEngine::Graphics::get_module_from_assets(const std::string &filename) -> vk::ShaderModule {
     auto data = AssetSystem::read_file_from_assets(filename);
     if (data.empty()) {
@@ -165,6 +169,7 @@ auto LoopEngine::Graphics::get_material_from_assets(const std::string &filename)
 //        pipeline_layout_create_info.setPPushConstantRanges(&push_constant_range);
 
     auto material = std::make_shared<Material>();
+    material->id = next_material_id.fetch_add(1, std::memory_order_relaxed);
     material->pipeline_layout = Context::get_instance()->device.createPipelineLayout(pipeline_layout_create_info);
 
     vk::PipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{};
@@ -10,6 +10,9 @@ namespace LoopEngine::Graphics {
 
         vk::Pipeline pipeline;
         vk::PipelineLayout pipeline_layout;
+
+        // dense id used to group draws by material in sort keys
+        uint32_t id = 0;
     };
 
     extern auto get_module_from_assets(const std::string& filename) -> vk::ShaderModule;
@@ -0,0 +1,99 @@
+#include "MemoryStats.hpp"
+#include "Context.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <fstream>
+
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::MemoryStats;
+using LoopEngine::Graphics::MemoryCategory;
+
+void LoopEngine::Graphics::track_allocation(MemoryCategory category, VmaAllocation allocation) {
+    if (allocation == nullptr) {
+        return;
+    }
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(Context::get_instance()->allocator, allocation, &info);
+
+    auto& stats = Context::get_instance()->memory_stats.categories[size_t(category)];
+    stats.allocation_count += 1;
+    stats.allocation_bytes += info.size;
+    stats.peak_allocation_count = std::max(stats.peak_allocation_count, stats.allocation_count);
+    stats.peak_allocation_bytes = std::max(stats.peak_allocation_bytes, stats.allocation_bytes);
+}
+
+void LoopEngine::Graphics::untrack_allocation(MemoryCategory category, VmaAllocation allocation) {
+    if (allocation == nullptr) {
+        return;
+    }
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(Context::get_instance()->allocator, allocation, &info);
+
+    auto& stats = Context::get_instance()->memory_stats.categories[size_t(category)];
+    stats.allocation_count -= std::min<size_t>(stats.allocation_count, 1);
+    stats.allocation_bytes -= std::min(stats.allocation_bytes, info.size);
+}
+
+void LoopEngine::Graphics::update_memory_stats(uint32_t frame_index) {
+    auto context = Context::get_instance();
+    vmaSetCurrentFrameIndex(context->allocator, frame_index);
+
+    const VkPhysicalDeviceMemoryProperties* properties = nullptr;
+    vmaGetMemoryProperties(context->allocator, &properties);
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+    vmaGetHeapBudgets(context->allocator, budgets.data());
+
+    auto& stats = context->memory_stats;
+    stats.budget_supported = context->memory_budget_supported;
+    stats.heaps.resize(properties->memoryHeapCount);
+    for (uint32_t i = 0; i < properties->memoryHeapCount; i++) {
+        auto& heap = stats.heaps[i];
+        heap.flags = vk::MemoryHeapFlags(properties->memoryHeaps[i].flags);
+        heap.size = properties->memoryHeaps[i].size;
+        heap.budget = budgets[i].budget;
+        heap.usage = budgets[i].usage;
+        heap.peak_usage = std::max(heap.peak_usage, heap.usage);
+        heap.block_count = budgets[i].statistics.blockCount;
+        heap.allocation_count = budgets[i].statistics.allocationCount;
+        heap.block_bytes = budgets[i].statistics.blockBytes;
+        heap.allocation_bytes = budgets[i].statistics.allocationBytes;
+    }
+}
+
+auto LoopEngine::Graphics::get_memory_stats() -> const MemoryStats& {
+    return Context::get_instance()->memory_stats;
+}
+
+auto LoopEngine::Graphics::get_memory_category_name(MemoryCategory category) -> const char* {
+    switch (category) {
+        case MemoryCategory::Vertex: return "Vertex";
+        case MemoryCategory::Index: return "Index";
+        case MemoryCategory::Uniform: return "Uniform";
+        case MemoryCategory::Depth: return "Depth";
+        case MemoryCategory::Texture: return "Texture";
+        case MemoryCategory::Staging: return "Staging";
+        case MemoryCategory::Indirect: return "Indirect";
+    }
+    return "Unknown";
+}
+
+auto LoopEngine::Graphics::dump_memory_stats_json(bool detailed) -> std::string {
+    char* raw = nullptr;
+    vmaBuildStatsString(Context::get_instance()->allocator, &raw, detailed ? VK_TRUE : VK_FALSE);
+
+    std::string json(raw);
+    vmaFreeStatsString(Context::get_instance()->allocator, raw);
+    return json;
+}
+
+auto LoopEngine::Graphics::save_memory_stats_json(const std::string& filename, bool detailed) -> bool {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        spdlog::error("Failed to open file {}", filename);
+        return false;
+    }
+    file << dump_memory_stats_json(detailed);
+    return true;
+}
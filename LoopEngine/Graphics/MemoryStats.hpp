@@ -0,0 +1,63 @@
+#pragma once
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace LoopEngine::Graphics {
+    enum class MemoryCategory {
+        Vertex,
+        Index,
+        Uniform,
+        Depth,
+        Texture,
+        Staging,
+        Indirect
+    };
+
+    inline constexpr size_t memory_category_count = 7;
+
+    struct MemoryHeapStats {
+        vk::MemoryHeapFlags flags{};
+        vk::DeviceSize size = 0;
+
+        // budget and usage as reported by the driver (VK_EXT_memory_budget when available)
+        vk::DeviceSize budget = 0;
+        vk::DeviceSize usage = 0;
+        vk::DeviceSize peak_usage = 0;
+
+        // memory owned by allocations made through the engine allocator
+        uint32_t block_count = 0;
+        uint32_t allocation_count = 0;
+        vk::DeviceSize block_bytes = 0;
+        vk::DeviceSize allocation_bytes = 0;
+    };
+
+    struct MemoryCategoryStats {
+        size_t allocation_count = 0;
+        size_t peak_allocation_count = 0;
+        vk::DeviceSize allocation_bytes = 0;
+        vk::DeviceSize peak_allocation_bytes = 0;
+    };
+
+    struct MemoryStats {
+        bool budget_supported = false;
+        std::vector<MemoryHeapStats> heaps{};
+        std::array<MemoryCategoryStats, memory_category_count> categories{};
+    };
+
+    extern void track_allocation(MemoryCategory category, VmaAllocation allocation);
+    extern void untrack_allocation(MemoryCategory category, VmaAllocation allocation);
+
+    // refreshes the per-heap budgets, expected to be called once per frame
+    extern void update_memory_stats(uint32_t frame_index);
+    extern auto get_memory_stats() -> const MemoryStats&;
+    extern auto get_memory_category_name(MemoryCategory category) -> const char*;
+
+    // JSON produced by vmaBuildStatsString
+    extern auto dump_memory_stats_json(bool detailed) -> std::string;
+    extern auto save_memory_stats_json(const std::string& filename, bool detailed) -> bool;
+}
@@ -0,0 +1,724 @@
+#include "RenderGraph.hpp"
+#include "Context.hpp"
+#include "MemoryStats.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::RenderGraph;
+using LoopEngine::Graphics::RenderGraphQueue;
+using LoopEngine::Graphics::RenderGraphAccess;
+using LoopEngine::Graphics::RenderGraphBuilder;
+using LoopEngine::Graphics::RenderGraphResource;
+using LoopEngine::Graphics::RenderGraphImageDesc;
+
+static constexpr auto write_access_mask =
+    vk::AccessFlagBits::eShaderWrite |
+    vk::AccessFlagBits::eColorAttachmentWrite |
+    vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+    vk::AccessFlagBits::eTransferWrite |
+    vk::AccessFlagBits::eHostWrite |
+    vk::AccessFlagBits::eMemoryWrite;
+
+static auto is_depth_format(vk::Format format) -> bool {
+    switch (format) {
+        case vk::Format::eD16Unorm:
+        case vk::Format::eX8D24UnormPack32:
+        case vk::Format::eD32Sfloat:
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static auto get_aspect_mask(vk::Format format) -> vk::ImageAspectFlags {
+    if (is_depth_format(format)) {
+        return vk::ImageAspectFlagBits::eDepth;
+    }
+    return vk::ImageAspectFlagBits::eColor;
+}
+
+static auto get_usage_from_access(const RenderGraphAccess& access) -> vk::ImageUsageFlags {
+    switch (access.layout) {
+        case vk::ImageLayout::eColorAttachmentOptimal:
+            return vk::ImageUsageFlagBits::eColorAttachment;
+        case vk::ImageLayout::eDepthStencilAttachmentOptimal:
+        case vk::ImageLayout::eDepthStencilReadOnlyOptimal:
+            return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        case vk::ImageLayout::eShaderReadOnlyOptimal:
+            return vk::ImageUsageFlagBits::eSampled;
+        case vk::ImageLayout::eGeneral:
+            return vk::ImageUsageFlagBits::eStorage;
+        case vk::ImageLayout::eTransferSrcOptimal:
+            return vk::ImageUsageFlagBits::eTransferSrc;
+        case vk::ImageLayout::eTransferDstOptimal:
+            return vk::ImageUsageFlagBits::eTransferDst;
+        default:
+            return {};
+    }
+}
+
+void RenderGraphBuilder::read(RenderGraphResource resource, const RenderGraphAccess& access) {
+    auto& usages = graph.passes[pass].usages;
+    for (auto& usage : usages) {
+        if (usage.resource == resource.index) {
+            usage.access.stages |= access.stages;
+            usage.access.access |= access.access;
+            return;
+        }
+    }
+    usages.push_back(RenderGraph::Usage{resource.index, access, false});
+}
+
+void RenderGraphBuilder::write(RenderGraphResource resource, const RenderGraphAccess& access) {
+    auto& usages = graph.passes[pass].usages;
+    for (auto& usage : usages) {
+        if (usage.resource == resource.index) {
+            usage.access.stages |= access.stages;
+            usage.access.access |= access.access;
+            usage.access.layout = access.layout;
+            usage.write = true;
+            return;
+        }
+    }
+    usages.push_back(RenderGraph::Usage{resource.index, access, true});
+}
+
+void RenderGraphBuilder::set_side_effects() {
+    graph.passes[pass].side_effects = true;
+}
+
+RenderGraph::RenderGraph(Context& context) : context(context) {}
+
+RenderGraph::~RenderGraph() {
+    reset();
+}
+
+auto RenderGraph::add_resource(Resource resource) -> RenderGraphResource {
+    compiled = false;
+    resources.emplace_back(std::move(resource));
+    return RenderGraphResource{static_cast<uint32_t>(resources.size() - 1)};
+}
+
+auto RenderGraph::import_image(const std::string& name, vk::Format format, vk::Extent2D extent, const RenderGraphAccess& initial_access, const RenderGraphAccess& final_access) -> RenderGraphResource {
+    Resource resource{};
+    resource.name = name;
+    resource.is_image = true;
+    resource.imported = true;
+    resource.format = format;
+    resource.extent = extent;
+    resource.initial_access = initial_access;
+    resource.final_access = final_access;
+    return add_resource(std::move(resource));
+}
+
+auto RenderGraph::import_buffer(const std::string& name, vk::DeviceSize size, const RenderGraphAccess& initial_access, const RenderGraphAccess& final_access) -> RenderGraphResource {
+    Resource resource{};
+    resource.name = name;
+    resource.is_image = false;
+    resource.imported = true;
+    resource.size = size;
+    resource.initial_access = initial_access;
+    resource.final_access = final_access;
+    return add_resource(std::move(resource));
+}
+
+auto RenderGraph::create_image(const std::string& name, const RenderGraphImageDesc& desc) -> RenderGraphResource {
+    Resource resource{};
+    resource.name = name;
+    resource.is_image = true;
+    resource.imported = false;
+    resource.desc = desc;
+    resource.format = desc.format;
+    return add_resource(std::move(resource));
+}
+
+void RenderGraph::add_pass(const std::string& name, RenderGraphQueue queue, const RenderGraphSetup& setup, RenderGraphExecute execute) {
+    compiled = false;
+    passes.emplace_back(Pass{name, queue, std::move(execute)});
+
+    RenderGraphBuilder builder{*this, static_cast<uint32_t>(passes.size() - 1)};
+    setup(builder);
+}
+
+void RenderGraph::add_resource_binder(RenderGraphBinder binder) {
+    binders.push_back(std::move(binder));
+}
+
+void RenderGraph::set_async_compute(bool enabled) {
+    if (async_compute != enabled) {
+        async_compute = enabled;
+        compiled = false;
+    }
+}
+
+void RenderGraph::compile(vk::Extent2D surface_extent) {
+    release_transient_images();
+
+    for (auto& pass : passes) {
+        pass.barriers.clear();
+        pass.releases.clear();
+    }
+    final_barriers.clear();
+
+    cull_passes();
+    assign_queues();
+
+    for (auto& resource : resources) {
+        resource.first_pass = RenderGraphResource::invalid;
+        resource.last_pass = RenderGraphResource::invalid;
+        resource.alias_previous = RenderGraphResource::invalid;
+        resource.compute_used = false;
+    }
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        if (passes[i].culled) {
+            continue;
+        }
+        for (auto& usage : passes[i].usages) {
+            auto& resource = resources[usage.resource];
+            if (resource.first_pass == RenderGraphResource::invalid) {
+                resource.first_pass = i;
+            }
+            resource.last_pass = i;
+            resource.compute_used |= passes[i].assigned_queue == RenderGraphQueue::Compute;
+        }
+    }
+
+    allocate_transient_images(surface_extent);
+    compute_barriers();
+
+    compiled = true;
+    executed = false;
+
+    auto culled = std::count_if(passes.begin(), passes.end(), [](const Pass& pass) { return pass.culled; });
+    spdlog::info("Render graph compiled: {} passes ({} culled, {} async compute), {} transient bytes", passes.size(), culled, compute_pass_count, transient_memory_size);
+}
+
+void RenderGraph::cull_passes() {
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t i = passes.size(); i-- > 0;) {
+        auto& pass = passes[i];
+
+        bool alive = pass.side_effects;
+        for (auto& usage : pass.usages) {
+            if (usage.write && (resources[usage.resource].imported || needed[usage.resource])) {
+                alive = true;
+            }
+        }
+        pass.culled = !alive;
+        if (!alive) {
+            continue;
+        }
+        for (auto& usage : pass.usages) {
+            // writes that also read keep the previous contents alive as well
+            if (!usage.write || (usage.access.access & ~write_access_mask)) {
+                needed[usage.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::assign_queues() {
+    compute_pass_count = 0;
+
+    std::vector<bool> graphics_used(resources.size(), false);
+    for (auto& pass : passes) {
+        if (pass.culled) {
+            continue;
+        }
+        pass.assigned_queue = RenderGraphQueue::Graphics;
+        if (pass.queue == RenderGraphQueue::Compute && async_compute) {
+            auto depends_on_graphics = std::any_of(pass.usages.begin(), pass.usages.end(), [&](const Usage& usage) {
+                return graphics_used[usage.resource];
+            });
+            if (!depends_on_graphics) {
+                pass.assigned_queue = RenderGraphQueue::Compute;
+            }
+        }
+
+        if (pass.assigned_queue == RenderGraphQueue::Compute) {
+            compute_pass_count += 1;
+        } else {
+            for (auto& usage : pass.usages) {
+                graphics_used[usage.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::allocate_transient_images(vk::Extent2D surface_extent) {
+    std::vector<uint32_t> transients{};
+    std::vector<vk::MemoryRequirements> requirements(resources.size());
+
+    for (uint32_t i = 0; i < resources.size(); i++) {
+        auto& resource = resources[i];
+        if (resource.imported || !resource.is_image || resource.first_pass == RenderGraphResource::invalid) {
+            continue;
+        }
+
+        resource.extent = resource.desc.extent;
+        if (resource.extent.width == 0 || resource.extent.height == 0) {
+            resource.extent.width = std::max(1u, static_cast<uint32_t>(float(surface_extent.width) * resource.desc.scale));
+            resource.extent.height = std::max(1u, static_cast<uint32_t>(float(surface_extent.height) * resource.desc.scale));
+        }
+
+        resource.usage = resource.desc.usage;
+        for (auto& pass : passes) {
+            if (pass.culled) {
+                continue;
+            }
+            for (auto& usage : pass.usages) {
+                if (usage.resource == i) {
+                    resource.usage |= get_usage_from_access(usage.access);
+                }
+            }
+        }
+
+        vk::ImageCreateInfo image_create_info{};
+        image_create_info.setImageType(vk::ImageType::e2D);
+        image_create_info.setFormat(resource.format);
+        image_create_info.setExtent({resource.extent.width, resource.extent.height, 1});
+        image_create_info.setMipLevels(resource.desc.mip_levels);
+        image_create_info.setArrayLayers(1);
+        image_create_info.setSamples(vk::SampleCountFlagBits::e1);
+        image_create_info.setTiling(vk::ImageTiling::eOptimal);
+        image_create_info.setUsage(resource.usage);
+        image_create_info.setSharingMode(vk::SharingMode::eExclusive);
+        image_create_info.setInitialLayout(vk::ImageLayout::eUndefined);
+
+        resource.image = context.device.createImage(image_create_info);
+        requirements[i] = context.device.getImageMemoryRequirements(resource.image);
+        transients.push_back(i);
+    }
+
+    // largest first, each image joins the first bucket whose members are all dead while it is alive
+    std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    auto overlaps = [&](uint32_t a, uint32_t b) {
+        return resources[a].first_pass <= resources[b].last_pass && resources[b].first_pass <= resources[a].last_pass;
+    };
+
+    for (auto index : transients) {
+        auto& resource = resources[index];
+
+        MemoryBucket* target = nullptr;
+        if (!resource.compute_used) {
+            for (auto& bucket : buckets) {
+                if ((bucket.requirements.memoryTypeBits & requirements[index].memoryTypeBits) == 0) {
+                    continue;
+                }
+                auto compatible = std::none_of(bucket.resources.begin(), bucket.resources.end(), [&](uint32_t other) {
+                    return resources[other].compute_used || overlaps(index, other);
+                });
+                if (compatible) {
+                    target = &bucket;
+                    break;
+                }
+            }
+        }
+        if (target == nullptr) {
+            target = &buckets.emplace_back();
+            target->requirements = requirements[index];
+        }
+
+        target->requirements.size = std::max(target->requirements.size, requirements[index].size);
+        target->requirements.alignment = std::max(target->requirements.alignment, requirements[index].alignment);
+        target->requirements.memoryTypeBits &= requirements[index].memoryTypeBits;
+        target->resources.push_back(index);
+    }
+
+    transient_memory_size = 0;
+    for (auto& bucket : buckets) {
+        VmaAllocationCreateInfo alloc_info{};
+        alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        auto memory_requirements = static_cast<VkMemoryRequirements>(bucket.requirements);
+        check(vk::Result(vmaAllocateMemory(context.allocator, &memory_requirements, &alloc_info, &bucket.allocation, nullptr)));
+        track_allocation(MemoryCategory::Texture, bucket.allocation);
+        transient_memory_size += bucket.requirements.size;
+
+        std::sort(bucket.resources.begin(), bucket.resources.end(), [&](uint32_t a, uint32_t b) {
+            return resources[a].first_pass < resources[b].first_pass;
+        });
+
+        for (size_t i = 0; i < bucket.resources.size(); i++) {
+            auto& resource = resources[bucket.resources[i]];
+
+            // the first alias of the frame takes the memory over from the last alias of the previous frame
+            resource.alias_previous = bucket.resources[(i + bucket.resources.size() - 1) % bucket.resources.size()];
+
+            check(vk::Result(vmaBindImageMemory(context.allocator, bucket.allocation, resource.image)));
+
+            vk::ImageViewCreateInfo view_create_info{};
+            view_create_info.setImage(resource.image);
+            view_create_info.setViewType(vk::ImageViewType::e2D);
+            view_create_info.setFormat(resource.format);
+            view_create_info.setSubresourceRange({get_aspect_mask(resource.format), 0, resource.desc.mip_levels, 0, 1});
+            resource.view = context.device.createImageView(view_create_info);
+        }
+    }
+}
+
+void RenderGraph::compute_barriers() {
+    compute_wait_stages = {};
+    compute_frame_wait_stages = {};
+
+    // the last use of a resource in a frame precedes its first use in the next one
+    std::vector<RenderGraphAccess> last_access(resources.size());
+    std::vector<uint32_t> last_pass(resources.size(), RenderGraphResource::invalid);
+    std::vector<bool> graphics_used(resources.size(), false);
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        auto& pass = passes[i];
+        if (pass.culled) {
+            continue;
+        }
+        for (auto& usage : pass.usages) {
+            last_access[usage.resource] = usage.access;
+            last_pass[usage.resource] = i;
+            if (pass.assigned_queue == RenderGraphQueue::Graphics) {
+                graphics_used[usage.resource] = true;
+            }
+        }
+    }
+
+    // async compute runs ahead of the graphics work of the previous frame, it has to wait for it
+    // before touching a resource the graphics passes use, unless the caller vouches for its state
+    for (auto& pass : passes) {
+        if (pass.culled || pass.assigned_queue != RenderGraphQueue::Compute) {
+            continue;
+        }
+        for (auto& usage : pass.usages) {
+            auto& resource = resources[usage.resource];
+            if (graphics_used[usage.resource] && !(resource.imported && resource.initial_access.is_specified())) {
+                compute_frame_wait_stages |= usage.access.stages;
+            }
+        }
+    }
+
+    struct State {
+        vk::PipelineStageFlags write_stages{};
+        vk::AccessFlags write_access{};
+        vk::PipelineStageFlags read_stages{};
+        vk::PipelineStageFlags visible_stages{};
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        RenderGraphQueue queue = RenderGraphQueue::Graphics;
+        uint32_t last_pass = RenderGraphResource::invalid;
+        bool carried_over = false;
+    };
+
+    std::vector<State> states(resources.size());
+    for (uint32_t i = 0; i < resources.size(); i++) {
+        auto& resource = resources[i];
+        auto& state = states[i];
+
+        RenderGraphAccess previous{};
+        if (resource.imported && resource.initial_access.is_specified()) {
+            previous = resource.initial_access;
+        } else if (resource.imported) {
+            previous = last_access[i];
+        } else if (resource.alias_previous != RenderGraphResource::invalid) {
+            previous = last_access[resource.alias_previous];
+            previous.layout = vk::ImageLayout::eUndefined;
+        } else {
+            // the contents of a transient do not survive the frame, but its last use still has to finish
+            previous = last_access[i];
+            previous.layout = vk::ImageLayout::eUndefined;
+        }
+
+        state.write_stages = previous.stages;
+        state.write_access = previous.access & write_access_mask;
+        state.layout = previous.layout;
+        if (resource.first_pass != RenderGraphResource::invalid) {
+            state.queue = passes[resource.first_pass].assigned_queue;
+        }
+
+        // a resource that keeps its contents across frames is owned by the queue that used it last,
+        // the release is recorded after that use and acquired by the first use of the next frame
+        if (resource.imported && !resource.initial_access.is_specified() && last_pass[i] != RenderGraphResource::invalid) {
+            state.queue = passes[last_pass[i]].assigned_queue;
+            state.last_pass = last_pass[i];
+            state.carried_over = true;
+        }
+    }
+
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        auto& pass = passes[i];
+        if (pass.culled) {
+            continue;
+        }
+
+        for (auto& usage : pass.usages) {
+            auto& resource = resources[usage.resource];
+            auto& state = states[usage.resource];
+
+            auto layout_change = resource.is_image && state.layout != usage.access.layout;
+            auto queue_change = state.queue != pass.assigned_queue;
+            auto hazard = usage.write || (state.write_access && (usage.access.stages & ~state.visible_stages));
+
+            if (!layout_change && !queue_change && !hazard) {
+                state.read_stages |= usage.access.stages;
+                continue;
+            }
+
+            Barrier barrier{};
+            barrier.resource = usage.resource;
+            barrier.src.stages = state.write_stages | state.read_stages;
+            barrier.src.access = state.write_access;
+            barrier.src.layout = state.layout;
+            barrier.dst = usage.access;
+            if (!resource.is_image) {
+                barrier.dst.layout = vk::ImageLayout::eUndefined;
+            }
+
+            if (queue_change) {
+                auto src_family = get_queue_family(state.queue);
+                auto dst_family = get_queue_family(pass.assigned_queue);
+                if (src_family != dst_family) {
+                    auto release = barrier;
+                    release.dst.stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+                    release.dst.access = {};
+                    release.src_queue_family = src_family;
+                    release.dst_queue_family = dst_family;
+                    passes[state.last_pass].releases.push_back(release);
+
+                    barrier.src_queue_family = src_family;
+                    barrier.dst_queue_family = dst_family;
+                    barrier.carried_over = state.carried_over;
+                }
+                // the semaphore wait already covers the execution and memory dependency
+                barrier.src.stages = usage.access.stages;
+                barrier.src.access = {};
+
+                if (pass.assigned_queue == RenderGraphQueue::Graphics) {
+                    compute_wait_stages |= usage.access.stages;
+                }
+            }
+
+            pass.barriers.push_back(barrier);
+
+            state.layout = usage.access.layout;
+            state.queue = pass.assigned_queue;
+            if (usage.write) {
+                state.write_stages = usage.access.stages;
+                state.write_access = usage.access.access & write_access_mask;
+                state.read_stages = {};
+                state.visible_stages = {};
+            } else {
+                state.read_stages = usage.access.stages;
+                state.visible_stages |= usage.access.stages;
+            }
+        }
+
+        for (auto& usage : pass.usages) {
+            states[usage.resource].last_pass = i;
+            states[usage.resource].carried_over = false;
+        }
+    }
+
+    for (uint32_t i = 0; i < resources.size(); i++) {
+        auto& resource = resources[i];
+        auto& state = states[i];
+        if (!resource.imported || !resource.final_access.is_specified()) {
+            continue;
+        }
+        if (resource.is_image && state.layout == resource.final_access.layout && !state.write_access) {
+            continue;
+        }
+
+        Barrier barrier{};
+        barrier.resource = i;
+        barrier.src.stages = state.write_stages | state.read_stages;
+        barrier.src.access = state.write_access;
+        barrier.src.layout = state.layout;
+        barrier.dst = resource.final_access;
+        final_barriers.push_back(barrier);
+    }
+}
+
+void RenderGraph::execute(vk::CommandBuffer graphics_cmd, vk::CommandBuffer compute_cmd) {
+    if (!compiled) {
+        throw std::runtime_error("Render graph must be compiled before execution");
+    }
+    if (compute_pass_count > 0 && !compute_cmd) {
+        throw std::runtime_error("Render graph has async compute passes but no compute command buffer");
+    }
+
+    for (auto& binder : binders) {
+        binder(*this);
+    }
+
+    for (auto& pass : passes) {
+        if (pass.culled) {
+            continue;
+        }
+        auto cmd = pass.assigned_queue == RenderGraphQueue::Compute ? compute_cmd : graphics_cmd;
+
+        record_barriers(cmd, pass.barriers);
+        pass.execute(cmd, *this);
+        record_barriers(cmd, pass.releases);
+    }
+    record_barriers(graphics_cmd, final_barriers);
+    executed = true;
+}
+
+void RenderGraph::record_barriers(vk::CommandBuffer cmd, const std::vector<Barrier>& barriers) {
+    if (barriers.empty()) {
+        return;
+    }
+
+    vk::PipelineStageFlags src_stages{};
+    vk::PipelineStageFlags dst_stages{};
+    std::vector<vk::ImageMemoryBarrier> image_barriers{};
+    std::vector<vk::BufferMemoryBarrier> buffer_barriers{};
+
+    for (auto& barrier : barriers) {
+        auto& resource = resources[barrier.resource];
+
+        src_stages |= barrier.src.stages;
+        dst_stages |= barrier.dst.stages;
+
+        // nothing released the resource before the first execution, so its first use takes it without a transfer
+        auto src_queue_family = barrier.src_queue_family;
+        auto dst_queue_family = barrier.dst_queue_family;
+        if (barrier.carried_over && !executed) {
+            src_queue_family = VK_QUEUE_FAMILY_IGNORED;
+            dst_queue_family = VK_QUEUE_FAMILY_IGNORED;
+        }
+
+        if (resource.is_image) {
+            vk::ImageMemoryBarrier image_barrier{};
+            image_barrier.setSrcAccessMask(barrier.src.access);
+            image_barrier.setDstAccessMask(barrier.dst.access);
+            image_barrier.setOldLayout(barrier.src.layout);
+            image_barrier.setNewLayout(barrier.dst.layout);
+            image_barrier.setSrcQueueFamilyIndex(src_queue_family);
+            image_barrier.setDstQueueFamilyIndex(dst_queue_family);
+            image_barrier.setImage(resource.image);
+            image_barrier.setSubresourceRange({get_aspect_mask(resource.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS});
+            image_barriers.push_back(image_barrier);
+        } else {
+            vk::BufferMemoryBarrier buffer_barrier{};
+            buffer_barrier.setSrcAccessMask(barrier.src.access);
+            buffer_barrier.setDstAccessMask(barrier.dst.access);
+            buffer_barrier.setSrcQueueFamilyIndex(src_queue_family);
+            buffer_barrier.setDstQueueFamilyIndex(dst_queue_family);
+            buffer_barrier.setBuffer(resource.buffer);
+            buffer_barrier.setOffset(0);
+            buffer_barrier.setSize(VK_WHOLE_SIZE);
+            buffer_barriers.push_back(buffer_barrier);
+        }
+    }
+
+    if (!src_stages) {
+        src_stages = vk::PipelineStageFlagBits::eTopOfPipe;
+    }
+    cmd.pipelineBarrier(src_stages, dst_stages, vk::DependencyFlags{}, nullptr, buffer_barriers, image_barriers);
+}
+
+void RenderGraph::reset() {
+    release_transient_images();
+
+    passes.clear();
+    resources.clear();
+    binders.clear();
+    final_barriers.clear();
+
+    compiled = false;
+    compute_pass_count = 0;
+    compute_wait_stages = {};
+}
+
+void RenderGraph::set_release_handler(RenderGraphRelease handler) {
+    release_handler = std::move(handler);
+}
+
+void RenderGraph::release_transient_images() {
+    std::vector<vk::Image> images{};
+    std::vector<vk::ImageView> views{};
+    std::vector<VmaAllocation> allocations{};
+
+    for (auto& resource : resources) {
+        if (resource.imported || !resource.is_image) {
+            continue;
+        }
+        if (resource.view) {
+            views.emplace_back(resource.view);
+        }
+        if (resource.image) {
+            images.emplace_back(resource.image);
+        }
+        resource.view = nullptr;
+        resource.image = nullptr;
+    }
+    for (auto& bucket : buckets) {
+        allocations.emplace_back(bucket.allocation);
+    }
+    buckets.clear();
+    transient_memory_size = 0;
+
+    if (images.empty() && views.empty() && allocations.empty()) {
+        return;
+    }
+
+    auto release = [&context = context, images = std::move(images), views = std::move(views), allocations = std::move(allocations)] {
+        for (auto view : views) {
+            context.device.destroyImageView(view);
+        }
+        for (auto image : images) {
+            context.device.destroyImage(image);
+        }
+        for (auto allocation : allocations) {
+            untrack_allocation(MemoryCategory::Texture, allocation);
+            vmaFreeMemory(context.allocator, allocation);
+        }
+    };
+
+    if (release_handler) {
+        release_handler(std::move(release));
+    } else {
+        release();
+    }
+}
+
+void RenderGraph::set_image(RenderGraphResource resource, vk::Image image, vk::ImageView view) {
+    resources[resource.index].image = image;
+    resources[resource.index].view = view;
+}
+
+void RenderGraph::set_buffer(RenderGraphResource resource, vk::Buffer buffer) {
+    resources[resource.index].buffer = buffer;
+}
+
+auto RenderGraph::get_image(RenderGraphResource resource) const -> vk::Image {
+    return resources[resource.index].image;
+}
+
+auto RenderGraph::get_image_view(RenderGraphResource resource) const -> vk::ImageView {
+    return resources[resource.index].view;
+}
+
+auto RenderGraph::get_image_extent(RenderGraphResource resource) const -> vk::Extent2D {
+    return resources[resource.index].extent;
+}
+
+auto RenderGraph::get_image_format(RenderGraphResource resource) const -> vk::Format {
+    return resources[resource.index].format;
+}
+
+auto RenderGraph::get_buffer(RenderGraphResource resource) const -> vk::Buffer {
+    return resources[resource.index].buffer;
+}
+
+auto RenderGraph::get_queue_family(RenderGraphQueue queue) const -> uint32_t {
+    if (queue == RenderGraphQueue::Compute) {
+        return context.compute_queue_family_index;
+    }
+    return context.graphics_queue_family_index;
+}
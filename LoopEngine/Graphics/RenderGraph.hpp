@@ -0,0 +1,314 @@
+#pragma once
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan.hpp>
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <functional>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+    struct RenderGraph;
+
+    enum class RenderGraphQueue {
+        Graphics,
+        Compute
+    };
+
+    struct RenderGraphAccess {
+        vk::PipelineStageFlags stages{};
+        vk::AccessFlags access{};
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+
+        [[nodiscard]] auto is_specified() const -> bool {
+            return bool(stages);
+        }
+    };
+
+    namespace RenderGraphAccesses {
+        inline constexpr auto color_attachment = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eColorAttachmentOutput,
+            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+            vk::ImageLayout::eColorAttachmentOptimal
+        };
+        inline constexpr auto depth_attachment = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+            vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal
+        };
+        inline constexpr auto depth_attachment_read = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+            vk::AccessFlagBits::eDepthStencilAttachmentRead,
+            vk::ImageLayout::eDepthStencilReadOnlyOptimal
+        };
+        inline constexpr auto fragment_sampled = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eFragmentShader,
+            vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+        inline constexpr auto compute_sampled = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+        inline constexpr auto compute_storage_read = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eGeneral
+        };
+        inline constexpr auto compute_storage_write = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            vk::ImageLayout::eGeneral
+        };
+        inline constexpr auto transfer_read = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::AccessFlagBits::eTransferRead,
+            vk::ImageLayout::eTransferSrcOptimal
+        };
+        inline constexpr auto transfer_write = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::AccessFlagBits::eTransferWrite,
+            vk::ImageLayout::eTransferDstOptimal
+        };
+        inline constexpr auto present = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eBottomOfPipe,
+            vk::AccessFlags{},
+            vk::ImageLayout::ePresentSrcKHR
+        };
+        inline constexpr auto vertex_buffer = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eVertexInput,
+            vk::AccessFlagBits::eVertexAttributeRead
+        };
+        inline constexpr auto index_buffer = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eVertexInput,
+            vk::AccessFlagBits::eIndexRead
+        };
+        inline constexpr auto indirect_buffer = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eDrawIndirect,
+            vk::AccessFlagBits::eIndirectCommandRead
+        };
+        inline constexpr auto vertex_uniform_buffer = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eVertexShader,
+            vk::AccessFlagBits::eUniformRead
+        };
+        inline constexpr auto vertex_storage_buffer = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eVertexShader,
+            vk::AccessFlagBits::eShaderRead
+        };
+        inline constexpr auto compute_buffer_read = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead
+        };
+        inline constexpr auto compute_buffer_write = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+        };
+        inline constexpr auto transfer_buffer_read = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::AccessFlagBits::eTransferRead
+        };
+        inline constexpr auto transfer_buffer_write = RenderGraphAccess{
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::AccessFlagBits::eTransferWrite
+        };
+    }
+
+    struct RenderGraphResource {
+        static constexpr uint32_t invalid = std::numeric_limits<uint32_t>::max();
+
+        uint32_t index = invalid;
+
+        explicit constexpr operator bool() const noexcept {
+            return index != invalid;
+        }
+    };
+
+    struct RenderGraphImageDesc {
+        vk::Format format = vk::Format::eUndefined;
+        // zero extent means "surface extent multiplied by scale"
+        vk::Extent2D extent{};
+        float scale = 1.0f;
+        uint32_t mip_levels = 1;
+        // usage implied by the declared accesses is added automatically
+        vk::ImageUsageFlags usage{};
+    };
+
+    struct RenderGraphBuilder {
+        void read(RenderGraphResource resource, const RenderGraphAccess& access);
+        void write(RenderGraphResource resource, const RenderGraphAccess& access);
+
+        // the pass is executed even if none of its outputs are consumed
+        void set_side_effects();
+
+    private:
+        friend RenderGraph;
+        RenderGraphBuilder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+        RenderGraph& graph;
+        uint32_t pass;
+    };
+
+    using RenderGraphSetup = std::function<void(RenderGraphBuilder&)>;
+    using RenderGraphExecute = std::function<void(vk::CommandBuffer, RenderGraph&)>;
+    using RenderGraphRelease = std::function<void(std::function<void()>)>;
+    using RenderGraphBinder = std::function<void(RenderGraph&)>;
+
+    // Passes are executed in declaration order. Compilation culls passes that do not contribute
+    // to an imported resource, precomputes the barriers between them and places transient images
+    // with disjoint lifetimes into shared memory.
+    struct RenderGraph {
+        explicit RenderGraph(Context& context);
+        ~RenderGraph();
+
+        RenderGraph(const RenderGraph&) = delete;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+
+        // initial access describes the state of the resource when the frame starts, an unspecified
+        // initial access means the resource keeps the state of its last use in the previous frame
+        auto import_image(const std::string& name, vk::Format format, vk::Extent2D extent, const RenderGraphAccess& initial_access, const RenderGraphAccess& final_access) -> RenderGraphResource;
+        auto import_buffer(const std::string& name, vk::DeviceSize size, const RenderGraphAccess& initial_access, const RenderGraphAccess& final_access) -> RenderGraphResource;
+        auto create_image(const std::string& name, const RenderGraphImageDesc& desc) -> RenderGraphResource;
+
+        void add_pass(const std::string& name, RenderGraphQueue queue, const RenderGraphSetup& setup, RenderGraphExecute execute);
+
+        // called at the beginning of every execution, before any barrier is recorded, to set imported
+        // resources that change from frame to frame, for example one buffer per frame in flight
+        void add_resource_binder(RenderGraphBinder binder);
+
+        // compute passes are scheduled on the compute queue when they do not depend on graphics work of the same frame
+        void set_async_compute(bool enabled);
+
+        void compile(vk::Extent2D surface_extent);
+        void execute(vk::CommandBuffer graphics_cmd, vk::CommandBuffer compute_cmd = {});
+
+        // destroys passes and resources, transient images are handed to the release handler when
+        // one is set, otherwise the caller must ensure the GPU no longer uses them
+        void reset();
+
+        // called with a function that destroys the transient images of a previous compilation
+        void set_release_handler(RenderGraphRelease handler);
+
+        void set_image(RenderGraphResource resource, vk::Image image, vk::ImageView view);
+        void set_buffer(RenderGraphResource resource, vk::Buffer buffer);
+
+        [[nodiscard]] auto get_image(RenderGraphResource resource) const -> vk::Image;
+        [[nodiscard]] auto get_image_view(RenderGraphResource resource) const -> vk::ImageView;
+        [[nodiscard]] auto get_image_extent(RenderGraphResource resource) const -> vk::Extent2D;
+        [[nodiscard]] auto get_image_format(RenderGraphResource resource) const -> vk::Format;
+        [[nodiscard]] auto get_buffer(RenderGraphResource resource) const -> vk::Buffer;
+
+        [[nodiscard]] auto is_compiled() const -> bool {
+            return compiled;
+        }
+
+        // stages of the graphics submission that consume compute results, empty if there is no cross-queue dependency
+        [[nodiscard]] auto get_compute_wait_stages() const -> vk::PipelineStageFlags {
+            return compute_wait_stages;
+        }
+
+        // stages of the compute submission that must wait for the graphics work of the previous frame, async compute
+        // passes overlap with the previous frame only if they avoid resources the graphics passes use as well, or
+        // import them with an explicit initial access, for example one buffer per frame in flight
+        [[nodiscard]] auto get_compute_frame_wait_stages() const -> vk::PipelineStageFlags {
+            return compute_frame_wait_stages;
+        }
+
+        [[nodiscard]] auto has_compute_work() const -> bool {
+            return compute_pass_count > 0;
+        }
+
+        [[nodiscard]] auto get_transient_memory_size() const -> vk::DeviceSize {
+            return transient_memory_size;
+        }
+
+    private:
+        friend RenderGraphBuilder;
+
+        struct Usage {
+            uint32_t resource;
+            RenderGraphAccess access;
+            bool write;
+        };
+
+        struct Barrier {
+            uint32_t resource;
+            RenderGraphAccess src;
+            RenderGraphAccess dst;
+            uint32_t src_queue_family = VK_QUEUE_FAMILY_IGNORED;
+            uint32_t dst_queue_family = VK_QUEUE_FAMILY_IGNORED;
+            // acquires ownership released by the last use in the previous frame
+            bool carried_over = false;
+        };
+
+        struct Pass {
+            std::string name;
+            RenderGraphQueue queue;
+            RenderGraphExecute execute;
+            std::vector<Usage> usages{};
+            bool side_effects = false;
+
+            bool culled = false;
+            RenderGraphQueue assigned_queue = RenderGraphQueue::Graphics;
+            std::vector<Barrier> barriers{};
+            std::vector<Barrier> releases{};
+        };
+
+        struct Resource {
+            std::string name;
+            bool is_image = true;
+            bool imported = false;
+            RenderGraphImageDesc desc{};
+            vk::DeviceSize size = 0;
+            RenderGraphAccess initial_access{};
+            RenderGraphAccess final_access{};
+
+            vk::Image image{};
+            vk::ImageView view{};
+            vk::Buffer buffer{};
+            vk::Format format = vk::Format::eUndefined;
+            vk::Extent2D extent{};
+            vk::ImageUsageFlags usage{};
+            bool compute_used = false;
+
+            uint32_t first_pass = RenderGraphResource::invalid;
+            uint32_t last_pass = RenderGraphResource::invalid;
+            uint32_t alias_previous = RenderGraphResource::invalid;
+        };
+
+        struct MemoryBucket {
+            vk::MemoryRequirements requirements{};
+            std::vector<uint32_t> resources{};
+            VmaAllocation allocation{};
+        };
+
+        auto add_resource(Resource resource) -> RenderGraphResource;
+
+        void cull_passes();
+        void assign_queues();
+        void allocate_transient_images(vk::Extent2D surface_extent);
+        void compute_barriers();
+        void release_transient_images();
+        void record_barriers(vk::CommandBuffer cmd, const std::vector<Barrier>& barriers);
+
+        [[nodiscard]] auto get_queue_family(RenderGraphQueue queue) const -> uint32_t;
+
+        Context& context;
+        RenderGraphRelease release_handler{};
+        std::vector<Pass> passes{};
+        std::vector<Resource> resources{};
+        std::vector<RenderGraphBinder> binders{};
+        std::vector<MemoryBucket> buckets{};
+        std::vector<Barrier> final_barriers{};
+
+        bool compiled = false;
+        bool executed = false;
+        bool async_compute = false;
+        size_t compute_pass_count = 0;
+        vk::DeviceSize transient_memory_size = 0;
+        vk::PipelineStageFlags compute_wait_stages{};
+        vk::PipelineStageFlags compute_frame_wait_stages{};
+    };
+}
@@ -0,0 +1,181 @@
+#include "RenderQueue.hpp"
+#include "Graphics.hpp"
+#include "Material.hpp"
+#include "InstanceBuffer.hpp"
+
+#include <bit>
+#include <cstring>
+
+using LoopEngine::Graphics::Material;
+using LoopEngine::Graphics::RenderLayer;
+using LoopEngine::Graphics::DrawPacket;
+using LoopEngine::Graphics::RenderQueue;
+using LoopEngine::Graphics::InstanceBuffer;
+using LoopEngine::Graphics::bind_global_descriptor_sets;
+
+// the bits of a non-negative float compare like the float itself
+static auto get_depth_bits(float depth) -> uint64_t {
+    return std::bit_cast<uint32_t>(std::max(depth, 0.0f));
+}
+
+auto RenderQueue::make_sort_key(RenderLayer layer, const Material& material, float depth) -> uint64_t {
+    // layer:4 | material:24 | depth:32, transparent layers swap material and inverted depth
+    auto layer_bits = uint64_t(layer) << 60;
+    auto material_bits = uint64_t(material.id & 0xFFFFFF);
+    if (layer == RenderLayer::Transparent) {
+        return layer_bits | ((~get_depth_bits(depth) & 0xFFFFFFFF) << 24) | material_bits;
+    }
+    return layer_bits | (material_bits << 32) | get_depth_bits(depth);
+}
+
+void RenderQueue::submit(const DrawPacket& packet) {
+    entries.push_back(SortEntry{packet.key, static_cast<uint32_t>(packets.size())});
+    packets.push_back(packet);
+}
+
+void RenderQueue::sort() {
+    if (entries.size() < 2) {
+        return;
+    }
+    scratch.resize(entries.size());
+
+    // least significant digit first, passes where every key shares the digit are skipped
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        std::array<size_t, 256> offsets{};
+        for (auto& entry : entries) {
+            offsets[(entry.key >> shift) & 0xFF] += 1;
+        }
+        if (offsets[(entries.front().key >> shift) & 0xFF] == entries.size()) {
+            continue;
+        }
+
+        size_t sum = 0;
+        for (auto& offset : offsets) {
+            auto count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (auto& entry : entries) {
+            scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
+
+auto RenderQueue::can_merge(const DrawPacket& a, const DrawPacket& b) -> bool {
+    if (a.instance_data == nullptr || b.instance_data == nullptr) {
+        return false;
+    }
+    if (a.material != b.material || a.index_buffer != b.index_buffer || a.index_type != b.index_type) {
+        return false;
+    }
+    if (a.count != b.count || a.first_index != b.first_index || a.vertex_offset != b.vertex_offset) {
+        return false;
+    }
+    if (a.instance_stride != b.instance_stride || a.instance_binding != b.instance_binding || a.vertex_buffer_count != b.vertex_buffer_count) {
+        return false;
+    }
+    for (uint32_t binding = 0; binding < a.vertex_buffer_count; binding++) {
+        if (binding == a.instance_binding) {
+            continue;
+        }
+        if (a.vertex_buffers[binding] != b.vertex_buffers[binding] || a.vertex_offsets[binding] != b.vertex_offsets[binding]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RenderQueue::batch(InstanceBuffer& instance_buffer, size_t frame) {
+    batched.clear();
+
+    for (size_t begin = 0; begin < entries.size();) {
+        auto& first = packets[entries[begin].index];
+
+        // the run of sorted packets that can be drawn together
+        auto end = begin + 1;
+        auto instance_count = first.instance_count;
+        while (end < entries.size() && can_merge(first, packets[entries[end].index])) {
+            instance_count += packets[entries[end].index].instance_count;
+            end += 1;
+        }
+
+        auto packet = first;
+        if (first.instance_data != nullptr) {
+            auto allocation = instance_buffer.allocate(frame, vk::DeviceSize(instance_count) * first.instance_stride);
+
+            auto data = static_cast<uint8_t*>(allocation.data);
+            for (auto i = begin; i < end; i++) {
+                auto& source = packets[entries[i].index];
+                auto size = size_t(source.instance_count) * source.instance_stride;
+                std::memcpy(data, static_cast<const uint8_t*>(source.instance_data) + size_t(source.first_instance) * source.instance_stride, size);
+                data += size;
+            }
+
+            packet.vertex_buffers[first.instance_binding] = allocation.buffer;
+            packet.vertex_offsets[first.instance_binding] = allocation.offset;
+            packet.vertex_buffer_count = std::max(packet.vertex_buffer_count, first.instance_binding + 1);
+            packet.instance_count = instance_count;
+            packet.first_instance = 0;
+            packet.instance_data = nullptr;
+        }
+        batched.push_back(packet);
+        begin = end;
+    }
+    instance_buffer.flush(frame);
+}
+
+void RenderQueue::execute(vk::CommandBuffer cmd, size_t begin, size_t end) const {
+    vk::Pipeline bound_pipeline{};
+    vk::PipelineLayout bound_layout{};
+    vk::Buffer bound_index_buffer{};
+    vk::IndexType bound_index_type = vk::IndexType::eUint32;
+    std::array<vk::Buffer, DrawPacket::max_vertex_buffers> bound_vertex_buffers{};
+    std::array<vk::DeviceSize, DrawPacket::max_vertex_buffers> bound_vertex_offsets{};
+
+    for (auto i = begin; i < end && i < batched.size(); i++) {
+        auto& packet = batched[i];
+        auto& material = *packet.material;
+
+        if (material.pipeline != bound_pipeline) {
+            cmd.bindPipeline(material.bind_point, material.pipeline);
+            bound_pipeline = material.pipeline;
+        }
+        if (material.pipeline_layout != bound_layout) {
+            bind_global_descriptor_sets(cmd, material, 0);
+            bound_layout = material.pipeline_layout;
+        }
+
+        // only the range of bindings that changed is rebound
+        uint32_t first = DrawPacket::max_vertex_buffers;
+        uint32_t last = 0;
+        for (uint32_t binding = 0; binding < packet.vertex_buffer_count; binding++) {
+            if (packet.vertex_buffers[binding] != bound_vertex_buffers[binding] || packet.vertex_offsets[binding] != bound_vertex_offsets[binding]) {
+                first = std::min(first, binding);
+                last = binding + 1;
+            }
+        }
+        if (first < last) {
+            cmd.bindVertexBuffers(first, last - first, &packet.vertex_buffers[first], &packet.vertex_offsets[first]);
+            std::copy(&packet.vertex_buffers[first], &packet.vertex_buffers[last], &bound_vertex_buffers[first]);
+            std::copy(&packet.vertex_offsets[first], &packet.vertex_offsets[last], &bound_vertex_offsets[first]);
+        }
+
+        if (!packet.index_buffer) {
+            cmd.draw(packet.count, packet.instance_count, static_cast<uint32_t>(packet.vertex_offset), packet.first_instance);
+            continue;
+        }
+        if (packet.index_buffer != bound_index_buffer || packet.index_type != bound_index_type) {
+            cmd.bindIndexBuffer(packet.index_buffer, 0, packet.index_type);
+            bound_index_buffer = packet.index_buffer;
+            bound_index_type = packet.index_type;
+        }
+        cmd.drawIndexed(packet.count, packet.instance_count, packet.first_index, packet.vertex_offset, packet.first_instance);
+    }
+}
+
+void RenderQueue::clear() {
+    packets.clear();
+    entries.clear();
+    batched.clear();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <vector>
+
+namespace LoopEngine::Graphics {
+    struct Material;
+    struct InstanceBuffer;
+
+    enum class RenderLayer : uint8_t {
+        Opaque,
+        Transparent,
+        Overlay
+    };
+
+    // everything needed to issue one indexed or non-indexed draw, the material must outlive the frame
+    struct DrawPacket {
+        static constexpr size_t max_vertex_buffers = 4;
+
+        uint64_t key = 0;
+        const Material* material = nullptr;
+
+        std::array<vk::Buffer, max_vertex_buffers> vertex_buffers{};
+        std::array<vk::DeviceSize, max_vertex_buffers> vertex_offsets{};
+        uint32_t vertex_buffer_count = 0;
+
+        // without an index buffer count is the number of vertices
+        vk::Buffer index_buffer{};
+        vk::IndexType index_type = vk::IndexType::eUint32;
+        uint32_t count = 0;
+        uint32_t instance_count = 1;
+        uint32_t first_index = 0;
+        int32_t vertex_offset = 0;
+        uint32_t first_instance = 0;
+
+        // instance data is copied into the shared instance buffer and bound to the instance binding,
+        // consecutive packets that only differ in their instances are merged into one draw
+        const void* instance_data = nullptr;
+        uint32_t instance_stride = 0;
+        uint32_t instance_binding = 0;
+    };
+
+    // Collects the draws of a frame, orders them by their sort keys, merges instanced draws of the same
+    // geometry and material and records them while skipping binds of the pipeline, the global descriptor
+    // set and the buffers that are already bound.
+    struct RenderQueue {
+        // opaque draws are grouped by material and drawn front to back, transparent draws are drawn back to front
+        static auto make_sort_key(RenderLayer layer, const Material& material, float depth) -> uint64_t;
+
+        void submit(const DrawPacket& packet);
+
+        // stable radix sort of the submitted packets by their keys
+        void sort();
+
+        // copies the instance data of the sorted packets into the frame's instance buffer
+        // and merges compatible neighbours into the draws recorded by execute
+        void batch(InstanceBuffer& instance_buffer, size_t frame);
+
+        // records the batched draws in the range, ranges may be recorded concurrently
+        void execute(vk::CommandBuffer cmd, size_t begin, size_t end) const;
+
+        void clear();
+
+        // the number of draws after batching
+        [[nodiscard]] auto size() const -> size_t {
+            return batched.size();
+        }
+
+        // packets submitted since the last clear
+        [[nodiscard]] auto get_submitted_count() const -> size_t {
+            return packets.size();
+        }
+
+    private:
+        struct SortEntry {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        static auto can_merge(const DrawPacket& a, const DrawPacket& b) -> bool;
+
+        std::vector<DrawPacket> packets{};
+        std::vector<DrawPacket> batched{};
+        std::vector<SortEntry> entries{};
+        std::vector<SortEntry> scratch{};
+    };
+}
@@ -0,0 +1,215 @@
+#include "TransferQueue.hpp"
+#include "Context.hpp"
+#include "MemoryStats.hpp"
+
+#include <cstring>
+
+using LoopEngine::Graphics::Context;
+using LoopEngine::Graphics::TransferQueue;
+
+TransferQueue::TransferQueue(Context& context) : context(context) {}
+
+void TransferQueue::initialize() {
+    vk::CommandPoolCreateInfo pool_create_info{};
+    pool_create_info.setQueueFamilyIndex(context.transfer_queue_family_index);
+    pool_create_info.setFlags(vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+    command_pool = context.device.createCommandPool(pool_create_info);
+
+    vk::SemaphoreTypeCreateInfo semaphore_type_create_info{};
+    semaphore_type_create_info.setSemaphoreType(vk::SemaphoreType::eTimeline);
+    semaphore_type_create_info.setInitialValue(0);
+
+    vk::SemaphoreCreateInfo semaphore_create_info{};
+    semaphore_create_info.setPNext(&semaphore_type_create_info);
+    timeline = context.device.createSemaphore(semaphore_create_info);
+}
+
+void TransferQueue::terminate() {
+    wait(submitted_value);
+    collect();
+
+    for (auto& upload : pending_uploads) {
+        release_staging_buffer(upload.staging);
+    }
+    pending_uploads.clear();
+
+    // destroying the pool frees its command buffers
+    free_command_buffers.clear();
+    context.device.destroyCommandPool(command_pool);
+    context.device.destroySemaphore(timeline);
+}
+
+auto TransferQueue::is_dedicated() const -> bool {
+    return context.transfer_queue_family_index != context.graphics_queue_family_index;
+}
+
+void TransferQueue::upload_buffer(vk::Buffer buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size, vk::PipelineStageFlags dst_stages, vk::AccessFlags dst_access) {
+    vk::BufferCreateInfo buffer_info{};
+    buffer_info.setSize(size);
+    buffer_info.setUsage(vk::BufferUsageFlagBits::eTransferSrc);
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+    PendingUpload upload{};
+    VmaAllocationInfo allocation_info{};
+    vmaCreateBuffer(context.allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, reinterpret_cast<VkBuffer *>(&upload.staging.buffer), &upload.staging.allocation, &allocation_info);
+    track_allocation(MemoryCategory::Staging, upload.staging.allocation);
+
+    std::memcpy(allocation_info.pMappedData, data, size);
+    vmaFlushAllocation(context.allocator, upload.staging.allocation, 0, VK_WHOLE_SIZE);
+
+    upload.buffer = buffer;
+    upload.offset = offset;
+    upload.size = size;
+    upload.dst_stages = dst_stages;
+    upload.dst_access = dst_access;
+
+    pending_uploads.emplace_back(upload);
+}
+
+auto TransferQueue::flush(vk::CommandBuffer graphics_cmd) -> vk::PipelineStageFlags {
+    std::vector<PendingUpload> uploads{};
+    uploads.swap(pending_uploads);
+    if (uploads.empty()) {
+        return {};
+    }
+
+    auto cmd = begin_commands();
+
+    vk::PipelineStageFlags dst_stages{};
+    std::vector<vk::BufferMemoryBarrier> barriers{};
+    std::vector<StagingBuffer> staging{};
+    for (auto& upload : uploads) {
+        vk::BufferCopy region{};
+        region.setSrcOffset(0);
+        region.setDstOffset(upload.offset);
+        region.setSize(upload.size);
+        cmd.copyBuffer(upload.staging.buffer, upload.buffer, region);
+
+        vk::BufferMemoryBarrier barrier{};
+        barrier.setBuffer(upload.buffer);
+        barrier.setOffset(upload.offset);
+        barrier.setSize(upload.size);
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+        if (is_dedicated()) {
+            // release, the access of the graphics queue is made visible by the acquire
+            barrier.setSrcQueueFamilyIndex(context.transfer_queue_family_index);
+            barrier.setDstQueueFamilyIndex(context.graphics_queue_family_index);
+        } else {
+            barrier.setDstAccessMask(upload.dst_access);
+            barrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+            barrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+        }
+        barriers.push_back(barrier);
+
+        dst_stages |= upload.dst_stages;
+        staging.push_back(upload.staging);
+    }
+
+    auto release_stages = is_dedicated() ? vk::PipelineStageFlags(vk::PipelineStageFlagBits::eBottomOfPipe) : dst_stages;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, release_stages, vk::DependencyFlags{}, nullptr, barriers, nullptr);
+    cmd.end();
+
+    upload_value = submit_commands(cmd, nullptr, 0, {}, std::move(staging));
+
+    if (is_dedicated()) {
+        // the acquire has to match the release, the semaphore wait orders it after the copy
+        for (size_t i = 0; i < uploads.size(); i++) {
+            barriers[i].setSrcAccessMask({});
+            barriers[i].setDstAccessMask(uploads[i].dst_access);
+        }
+        graphics_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, dst_stages, vk::DependencyFlags{}, nullptr, barriers, nullptr);
+    }
+    return dst_stages;
+}
+
+auto TransferQueue::submit(const TransferRecordFunction& record, vk::Semaphore wait_semaphore, uint64_t wait_value, vk::PipelineStageFlags wait_stages) -> uint64_t {
+    auto cmd = begin_commands();
+    record(cmd);
+    cmd.end();
+    return submit_commands(cmd, wait_semaphore, wait_value, wait_stages, {});
+}
+
+void TransferQueue::wait(uint64_t value) {
+    if (value == 0) {
+        return;
+    }
+
+    vk::SemaphoreWaitInfo wait_info{};
+    wait_info.setSemaphoreCount(1);
+    wait_info.setPSemaphores(&timeline);
+    wait_info.setPValues(&value);
+    check(context.device.waitSemaphores(wait_info, std::numeric_limits<uint64_t>::max()));
+}
+
+void TransferQueue::collect() {
+    if (submissions.empty()) {
+        return;
+    }
+
+    auto completed_value = context.device.getSemaphoreCounterValue(timeline);
+    while (!submissions.empty() && submissions.front().value <= completed_value) {
+        auto& submission = submissions.front();
+        for (auto& staging : submission.staging) {
+            release_staging_buffer(staging);
+        }
+        free_command_buffers.push_back(submission.cmd);
+        submissions.pop_front();
+    }
+}
+
+auto TransferQueue::begin_commands() -> vk::CommandBuffer {
+    collect();
+
+    vk::CommandBuffer cmd{};
+    if (free_command_buffers.empty()) {
+        vk::CommandBufferAllocateInfo alloc_info{};
+        alloc_info.setCommandPool(command_pool);
+        alloc_info.setLevel(vk::CommandBufferLevel::ePrimary);
+        alloc_info.setCommandBufferCount(1);
+        cmd = context.device.allocateCommandBuffers(alloc_info).front();
+    } else {
+        cmd = free_command_buffers.back();
+        free_command_buffers.pop_back();
+    }
+
+    vk::CommandBufferBeginInfo begin_info{};
+    begin_info.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    cmd.begin(begin_info);
+    return cmd;
+}
+
+auto TransferQueue::submit_commands(vk::CommandBuffer cmd, vk::Semaphore wait_semaphore, uint64_t wait_value, vk::PipelineStageFlags wait_stages, std::vector<StagingBuffer> staging) -> uint64_t {
+    auto signal_value = submitted_value + 1;
+
+    vk::TimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.setSignalSemaphoreValueCount(1);
+    timeline_info.setPSignalSemaphoreValues(&signal_value);
+
+    vk::SubmitInfo submit_info{};
+    submit_info.setPNext(&timeline_info);
+    submit_info.setCommandBufferCount(1);
+    submit_info.setPCommandBuffers(&cmd);
+    submit_info.setSignalSemaphoreCount(1);
+    submit_info.setPSignalSemaphores(&timeline);
+    if (wait_semaphore) {
+        timeline_info.setWaitSemaphoreValueCount(1);
+        timeline_info.setPWaitSemaphoreValues(&wait_value);
+        submit_info.setWaitSemaphoreCount(1);
+        submit_info.setPWaitSemaphores(&wait_semaphore);
+        submit_info.setPWaitDstStageMask(&wait_stages);
+    }
+
+    check(context.transfer_queue.submit(1, &submit_info, vk::Fence{}));
+
+    submitted_value = signal_value;
+    submissions.emplace_back(Submission{signal_value, cmd, std::move(staging)});
+    return signal_value;
+}
+
+void TransferQueue::release_staging_buffer(const StagingBuffer& staging) {
+    untrack_allocation(MemoryCategory::Staging, staging.allocation);
+    vmaDestroyBuffer(context.allocator, staging.buffer, staging.allocation);
+}
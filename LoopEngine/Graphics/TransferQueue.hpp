@@ -0,0 +1,92 @@
+#pragma once
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan.hpp>
+
+#include <deque>
+#include <vector>
+#include <functional>
+
+namespace LoopEngine::Graphics {
+    struct Context;
+
+    using TransferRecordFunction = std::function<void(vk::CommandBuffer)>;
+
+    // Runs staging uploads and readbacks on the dedicated transfer queue, so copies overlap with rendering instead
+    // of competing with it. Buffers move between the transfer and graphics families with release and acquire barriers.
+    // Without a dedicated family the graphics queue is used and no ownership transfer is recorded.
+    struct TransferQueue {
+        explicit TransferQueue(Context& context);
+
+        void initialize();
+        void terminate();
+
+        [[nodiscard]] auto is_dedicated() const -> bool;
+
+        // the timeline reaches the value returned by submit once the transfer has finished
+        [[nodiscard]] auto get_timeline() const -> vk::Semaphore {
+            return timeline;
+        }
+
+        [[nodiscard]] auto get_submitted_value() const -> uint64_t {
+            return submitted_value;
+        }
+
+        // the value of the last flushed uploads, readbacks submitted since then do not advance it
+        [[nodiscard]] auto get_upload_value() const -> uint64_t {
+            return upload_value;
+        }
+
+        // copies the data into a staging buffer and queues a copy into the buffer,
+        // the buffer is available at the given stages to the first graphics submission after the next flush
+        void upload_buffer(vk::Buffer buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size, vk::PipelineStageFlags dst_stages, vk::AccessFlags dst_access);
+
+        // submits the queued uploads and records their acquire barriers into the graphics command buffer,
+        // returns the stages the graphics submission has to wait at for the submitted value
+        auto flush(vk::CommandBuffer graphics_cmd) -> vk::PipelineStageFlags;
+
+        // records and submits commands once the semaphore has reached the value, returns the value signalled on completion
+        auto submit(const TransferRecordFunction& record, vk::Semaphore wait_semaphore, uint64_t wait_value, vk::PipelineStageFlags wait_stages) -> uint64_t;
+
+        void wait(uint64_t value);
+
+        // frees command buffers and staging buffers of finished transfers
+        void collect();
+
+    private:
+        struct StagingBuffer {
+            vk::Buffer buffer{};
+            VmaAllocation allocation{};
+        };
+
+        struct PendingUpload {
+            StagingBuffer staging{};
+            vk::Buffer buffer{};
+            vk::DeviceSize offset = 0;
+            vk::DeviceSize size = 0;
+            vk::PipelineStageFlags dst_stages{};
+            vk::AccessFlags dst_access{};
+        };
+
+        struct Submission {
+            uint64_t value = 0;
+            vk::CommandBuffer cmd{};
+            std::vector<StagingBuffer> staging{};
+        };
+
+        auto begin_commands() -> vk::CommandBuffer;
+        auto submit_commands(vk::CommandBuffer cmd, vk::Semaphore wait_semaphore, uint64_t wait_value, vk::PipelineStageFlags wait_stages, std::vector<StagingBuffer> staging) -> uint64_t;
+        void release_staging_buffer(const StagingBuffer& staging);
+
+        Context& context;
+        vk::CommandPool command_pool{};
+        std::vector<vk::CommandBuffer> free_command_buffers{};
+
+        vk::Semaphore timeline{};
+        uint64_t submitted_value = 0;
+        uint64_t upload_value = 0;
+        std::deque<Submission> submissions{};
+
+        std::vector<PendingUpload> pending_uploads{};
+    };
+}
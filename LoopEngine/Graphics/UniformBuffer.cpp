@@ -1,5 +1,6 @@
 #include "UniformBuffer.hpp"
 #include "Context.hpp"
+#include "MemoryStats.hpp"
 
 auto LoopEngine::Graphics::create_uniform_buffer(vk::DeviceSize size) -> std::shared_ptr<UniformBuffer> {
     vk::BufferUsageFlags usage;
@@ -16,6 +17,7 @@ auto LoopEngine::Graphics::create_uniform_buffer(vk::DeviceSize size) -> std::sh
     VkBuffer handle;
     VmaAllocation allocation;
     vmaCreateBuffer(Context::get_instance()->allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, &handle, &allocation, nullptr);
+    track_allocation(MemoryCategory::Uniform, allocation);
 
     auto buffer = std::make_shared<UniformBuffer>();
     buffer->handle = handle;
@@ -24,6 +26,7 @@ auto LoopEngine::Graphics::create_uniform_buffer(vk::DeviceSize size) -> std::sh
 }
 
 void LoopEngine::Graphics::release_uniform_buffer(const UniformBuffer &buffer) {
+    untrack_allocation(MemoryCategory::Uniform, buffer.allocation);
     vmaDestroyBuffer(Context::get_instance()->allocator, buffer.handle, buffer.allocation);
 }
 
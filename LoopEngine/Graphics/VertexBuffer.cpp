@@ -1,5 +1,7 @@
 #include "VertexBuffer.hpp"
 #include "Context.hpp"
+#include "Graphics.hpp"
+#include "MemoryStats.hpp"
 
 auto LoopEngine::Graphics::create_vertex_buffer(vk::DeviceSize size) -> std::shared_ptr<VertexBuffer> {
     vk::BufferUsageFlags usage;
@@ -16,6 +18,30 @@ auto LoopEngine::Graphics::create_vertex_buffer(vk::DeviceSize size) -> std::sha
     VkBuffer handle;
     VmaAllocation allocation;
     vmaCreateBuffer(Context::get_instance()->allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, &handle, &allocation, nullptr);
+    track_allocation(MemoryCategory::Vertex, allocation);
+
+    auto buffer = std::make_shared<VertexBuffer>();
+    buffer->handle = handle;
+    buffer->allocation = allocation;
+    return buffer;
+}
+
+auto LoopEngine::Graphics::create_static_vertex_buffer(vk::DeviceSize size) -> std::shared_ptr<VertexBuffer> {
+    vk::BufferUsageFlags usage;
+    usage |= vk::BufferUsageFlagBits::eVertexBuffer;
+    usage |= vk::BufferUsageFlagBits::eTransferDst;
+
+    vk::BufferCreateInfo buffer_info{};
+    buffer_info.setSize(size);
+    buffer_info.setUsage(usage);
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    VkBuffer handle;
+    VmaAllocation allocation;
+    vmaCreateBuffer(Context::get_instance()->allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_info, &handle, &allocation, nullptr);
+    track_allocation(MemoryCategory::Vertex, allocation);
 
     auto buffer = std::make_shared<VertexBuffer>();
     buffer->handle = handle;
@@ -24,6 +50,7 @@ auto LoopEngine::Graphics::create_vertex_buffer(vk::DeviceSize size) -> std::sha
 }
 
 void LoopEngine::Graphics::release_vertex_buffer(const VertexBuffer &buffer) {
+    untrack_allocation(MemoryCategory::Vertex, buffer.allocation);
     vmaDestroyBuffer(Context::get_instance()->allocator, buffer.handle, buffer.allocation);
 }
 
@@ -42,3 +69,6 @@ void LoopEngine::Graphics::update_vertex_buffer(const VertexBuffer &buffer, cons
     unmap_vertex_buffer(buffer);
 }
 
+void LoopEngine::Graphics::upload_vertex_buffer(const VertexBuffer &buffer, const void *data, vk::DeviceSize size) {
+    Graphics::get_instance()->get_transfer_queue().upload_buffer(buffer.handle, 0, data, size, vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
+}
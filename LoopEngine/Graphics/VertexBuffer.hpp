@@ -13,9 +13,12 @@ namespace LoopEngine::Graphics {
     };
 
     extern auto create_vertex_buffer(vk::DeviceSize size) -> std::shared_ptr<VertexBuffer>;
+    // device local buffer that is only written through the transfer queue
+    extern auto create_static_vertex_buffer(vk::DeviceSize size) -> std::shared_ptr<VertexBuffer>;
     extern void release_vertex_buffer(const VertexBuffer& buffer);
 
     extern auto map_vertex_buffer(const VertexBuffer &buffer) -> void*;
     extern void unmap_vertex_buffer(const VertexBuffer &buffer);
     extern void update_vertex_buffer(const VertexBuffer &buffer, const void *data, vk::DeviceSize size);
+    extern void upload_vertex_buffer(const VertexBuffer &buffer, const void *data, vk::DeviceSize size);
 }
\ No newline at end of file
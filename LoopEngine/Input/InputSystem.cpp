@@ -100,6 +100,12 @@ auto InputSystem::get_mouse_delta() const -> const glm::vec2 & {
 }
 
 void InputSystem::update(float dt) {
+    // there is no keyboard or mouse to sample without a window
+    if (Application::get_instance()->get_window().is_headless()) {
+        mouse_delta = glm::vec2(0.0f);
+        return;
+    }
+
     auto window = Application::get_instance()->get_window().get_native_handle();
 
     double x, y;
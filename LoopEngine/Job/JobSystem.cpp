@@ -0,0 +1,90 @@
+#include "JobSystem.hpp"
+
+#include "LoopEngine/Profiler/CpuProfiler.hpp"
+#include "spdlog/spdlog.h"
+
+using LoopEngine::Core::Singleton;
+using LoopEngine::Job::JobSystem;
+
+template<> JobSystem* Singleton<JobSystem>::instance = nullptr;
+
+JobSystem::JobSystem() {
+    auto concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t i = 1; i < concurrency; i++) {
+        workers.emplace_back(&JobSystem::worker_main, this, i);
+    }
+    spdlog::info("Job system started with {} threads", get_thread_count());
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake_condition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::parallel_for(size_t count, const JobFunction& function) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || workers.empty()) {
+        for (size_t i = 0; i < count; i++) {
+            function(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        current_function = &function;
+        current_count = count;
+        next_index.store(0, std::memory_order_relaxed);
+        busy_workers = workers.size();
+        generation += 1;
+    }
+    wake_condition.notify_all();
+
+    run_jobs(0);
+
+    std::unique_lock lock(mutex);
+    done_condition.wait(lock, [this] { return busy_workers == 0; });
+    current_function = nullptr;
+}
+
+void JobSystem::worker_main(size_t thread_index) {
+    LOOP_PROFILE_THREAD(fmt::format("Worker {}", thread_index));
+
+    size_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake_condition.wait(lock, [&] { return stopping || generation != seen_generation; });
+            if (stopping) {
+                return;
+            }
+            seen_generation = generation;
+        }
+
+        run_jobs(thread_index);
+
+        {
+            std::lock_guard lock(mutex);
+            busy_workers -= 1;
+        }
+        done_condition.notify_one();
+    }
+}
+
+void JobSystem::run_jobs(size_t thread_index) {
+    while (true) {
+        auto index = next_index.fetch_add(1, std::memory_order_relaxed);
+        if (index >= current_count) {
+            return;
+        }
+        (*current_function)(index, thread_index);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "LoopEngine/Core/Singleton.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+namespace LoopEngine::Job {
+    // Fixed pool of worker threads. The calling thread takes part in the work as thread 0,
+    // workers are numbered from 1, so per-thread data can be indexed with [0, get_thread_count()).
+    struct JobSystem final : LoopEngine::Core::Singleton<JobSystem> {
+        using JobFunction = std::function<void(size_t index, size_t thread_index)>;
+
+        JobSystem();
+        ~JobSystem();
+
+        [[nodiscard]] auto get_thread_count() const -> size_t {
+            return workers.size() + 1;
+        }
+
+        // runs function for every index in [0, count) and returns when all of them are done
+        void parallel_for(size_t count, const JobFunction& function);
+
+    private:
+        void worker_main(size_t thread_index);
+        void run_jobs(size_t thread_index);
+
+        std::vector<std::thread> workers{};
+
+        std::mutex mutex{};
+        std::condition_variable wake_condition{};
+        std::condition_variable done_condition{};
+
+        const JobFunction* current_function = nullptr;
+        size_t current_count = 0;
+        size_t generation = 0;
+        size_t busy_workers = 0;
+        bool stopping = false;
+
+        std::atomic<size_t> next_index{0};
+    };
+}
@@ -48,7 +48,7 @@ namespace LoopEngine {
                 LoopEngine::Event::EventSystem::get_global_event_queue()->remove_event_handler(&init_event_handler);
             }
             if constexpr(requires(Self self, float dt) { self.on_update(dt); }) {
-                LoopEngine::Event::EventSystem::get_global_event_queue()->remove_event_handler(&quit_event_handler);
+                LoopEngine::Event::EventSystem::get_global_event_queue()->remove_event_handler(&update_event_handler);
             }
             if constexpr(requires(Self self, vk::CommandBuffer cmd) { self.on_before_draw(cmd); }) {
                 LoopEngine::Event::EventSystem::get_global_event_queue()->remove_event_handler(&before_draw_event_handler);
@@ -60,7 +60,7 @@ namespace LoopEngine {
                 LoopEngine::Event::EventSystem::get_global_event_queue()->remove_event_handler(&after_draw_event_handler);
             }
             if constexpr(requires(Self self) { self.on_destroy(); }) {
-                LoopEngine::Event::EventSystem::get_global_event_queue()->remove_event_handler(&update_event_handler);
+                LoopEngine::Event::EventSystem::get_global_event_queue()->remove_event_handler(&quit_event_handler);
             }
         }
 
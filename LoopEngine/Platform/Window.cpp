@@ -3,7 +3,11 @@
 using LoopEngine::Core::Singleton;
 using LoopEngine::Platform::Window;
 
-Window::Window(int width, int height, const char *title) {
+Window::Window(int width, int height, const char *title, bool headless) : headless(headless), width(width), height(height) {
+    if (headless) {
+        return;
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -15,18 +19,47 @@ Window::Window(int width, int height, const char *title) {
 }
 
 Window::~Window() {
+    if (headless) {
+        return;
+    }
     glfwDestroyWindow((GLFWwindow*) handle);
     glfwTerminate();
 }
 
 auto Window::should_close() -> bool {
-    return glfwWindowShouldClose((GLFWwindow*) handle);
+    if (headless) {
+        return close_requested;
+    }
+    return close_requested || glfwWindowShouldClose((GLFWwindow*) handle);
 }
 
 void Window::poll_events() {
+    if (headless) {
+        return;
+    }
     glfwPollEvents();
 }
 
+void Window::wait_events(double timeout) {
+    if (headless) {
+        return;
+    }
+    glfwWaitEventsTimeout(timeout);
+}
+
+void Window::request_close() {
+    close_requested = true;
+}
+
+void Window::get_framebuffer_size(int& out_width, int& out_height) {
+    if (headless) {
+        out_width = width;
+        out_height = height;
+        return;
+    }
+    glfwGetFramebufferSize((GLFWwindow*) handle, &out_width, &out_height);
+}
+
 auto Window::get_native_handle() -> GLFWwindow * {
     return (GLFWwindow*) handle;
-}
\ No newline at end of file
+}
@@ -4,15 +4,27 @@
 #include "GLFW/glfw3.h"
 
 namespace LoopEngine::Platform {
+    // A headless window has no native handle, it only keeps its size and is closed on request.
     struct Window final {
-        Window(int width, int height, const char *title);
+        Window(int width, int height, const char *title, bool headless = false);
         ~Window();
 
         auto get_native_handle() -> GLFWwindow*;
         auto should_close() -> bool;
         void poll_events();
+        void wait_events(double timeout);
+        void request_close();
+        void get_framebuffer_size(int& width, int& height);
+
+        [[nodiscard]] auto is_headless() const -> bool {
+            return headless;
+        }
 
     private:
-        GLFWwindow* handle;
+        GLFWwindow* handle = nullptr;
+        bool headless = false;
+        bool close_requested = false;
+        int width = 0;
+        int height = 0;
     };
-}
\ No newline at end of file
+}
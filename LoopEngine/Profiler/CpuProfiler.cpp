@@ -0,0 +1,163 @@
+#include "CpuProfiler.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <vector>
+#include <thread>
+
+namespace {
+    struct Event {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> begin{0};
+        std::atomic<uint64_t> end{0};
+    };
+
+    // written by its owning thread only, the exporter reads it concurrently
+    struct ThreadBuffer {
+        std::array<Event, LoopEngine::Profiler::thread_event_capacity> events{};
+        std::atomic<uint64_t> write_index{0};
+        std::atomic<ThreadBuffer*> next{nullptr};
+        uint32_t thread_id = 0;
+
+        std::atomic<bool> has_name{false};
+        std::array<char, 32> name{};
+    };
+
+    std::atomic<ThreadBuffer*> thread_buffers{nullptr};
+    std::atomic<uint32_t> next_thread_id{0};
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // buffers are never freed, threads that exit keep their events until the next export
+    auto get_thread_buffer() -> ThreadBuffer& {
+        thread_local ThreadBuffer* buffer = [] {
+            auto buffer = new ThreadBuffer();
+            buffer->thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+
+            auto head = thread_buffers.load(std::memory_order_relaxed);
+            do {
+                buffer->next.store(head, std::memory_order_relaxed);
+            } while (!thread_buffers.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+            return buffer;
+        }();
+        return *buffer;
+    }
+
+    void write_escaped(std::ofstream& file, const char* text) {
+        for (; *text != '\0'; text++) {
+            if (*text == '"' || *text == '\\') {
+                file << '\\';
+            }
+            file << *text;
+        }
+    }
+}
+
+auto LoopEngine::Profiler::get_time() -> uint64_t {
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void LoopEngine::Profiler::record_event(const char* name, uint64_t begin, uint64_t end) {
+    auto& buffer = get_thread_buffer();
+
+    auto index = buffer.write_index.load(std::memory_order_relaxed);
+    auto& event = buffer.events[index % thread_event_capacity];
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(begin, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    buffer.write_index.store(index + 1, std::memory_order_release);
+}
+
+void LoopEngine::Profiler::set_thread_name(const std::string& name) {
+    auto& buffer = get_thread_buffer();
+
+    auto length = std::min(name.size(), buffer.name.size() - 1);
+    std::copy_n(name.begin(), length, buffer.name.begin());
+    buffer.name[length] = '\0';
+    buffer.has_name.store(true, std::memory_order_release);
+}
+
+auto LoopEngine::Profiler::save_chrome_trace(const std::string& filename) -> bool {
+#ifndef LOOP_ENABLE_PROFILER
+    spdlog::warn("CPU profiler is disabled, build with LOOP_ENABLE_PROFILER to record a trace");
+    return false;
+#else
+    std::ofstream file(filename);
+    if (!file) {
+        spdlog::error("Failed to open {}", filename);
+        return false;
+    }
+
+    struct Snapshot {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    file << R"({"displayTimeUnit":"ms","traceEvents":[)";
+
+    bool first = true;
+    size_t event_count = 0;
+    auto separator = [&] {
+        if (!first) {
+            file << ",";
+        }
+        first = false;
+    };
+
+    for (auto buffer = thread_buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next.load(std::memory_order_relaxed)) {
+        if (buffer->has_name.load(std::memory_order_acquire)) {
+            separator();
+            file << R"({"ph":"M","name":"thread_name","pid":0,"tid":)" << buffer->thread_id << R"(,"args":{"name":")";
+            write_escaped(file, buffer->name.data());
+            file << R"("}})";
+        }
+
+        auto end_index = buffer->write_index.load(std::memory_order_acquire);
+        auto begin_index = end_index > thread_event_capacity ? end_index - thread_event_capacity : 0;
+
+        std::vector<Snapshot> snapshots{};
+        snapshots.reserve(end_index - begin_index);
+        for (auto i = begin_index; i < end_index; i++) {
+            auto& event = buffer->events[i % thread_event_capacity];
+            snapshots.push_back(Snapshot{
+                event.name.load(std::memory_order_relaxed),
+                event.begin.load(std::memory_order_relaxed),
+                event.end.load(std::memory_order_relaxed)
+            });
+        }
+
+        // the owning thread kept recording while the events were copied, drop the ones it may have overwritten,
+        // including the slot of the event at the write index that it may be writing right now
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto written = buffer->write_index.load(std::memory_order_relaxed);
+        auto overwritten = written + 1 > thread_event_capacity ? written + 1 - thread_event_capacity : 0;
+        auto skip = overwritten > begin_index ? std::min<uint64_t>(overwritten - begin_index, snapshots.size()) : 0;
+
+        for (auto i = skip; i < snapshots.size(); i++) {
+            auto& snapshot = snapshots[i];
+            if (snapshot.name == nullptr) {
+                continue;
+            }
+            separator();
+            file << R"({"ph":"X","pid":0,"tid":)" << buffer->thread_id;
+            file << R"(,"ts":)" << double(snapshot.begin) / 1000.0;
+            file << R"(,"dur":)" << double(snapshot.end - snapshot.begin) / 1000.0;
+            file << R"(,"name":")";
+            write_escaped(file, snapshot.name);
+            file << R"("})";
+            event_count += 1;
+        }
+    }
+    file << "]}";
+
+    spdlog::info("Saved {} CPU profiler events to {}", event_count, filename);
+    return true;
+#endif
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// LOOP_PROFILE_SCOPE records the time between its declaration and the end of the enclosing block.
+// The name must be a string literal. Without LOOP_ENABLE_PROFILER the macros expand to nothing.
+#ifdef LOOP_ENABLE_PROFILER
+#define LOOP_PROFILE_CONCAT_IMPL(a, b) a##b
+#define LOOP_PROFILE_CONCAT(a, b) LOOP_PROFILE_CONCAT_IMPL(a, b)
+#define LOOP_PROFILE_SCOPE(name) ::LoopEngine::Profiler::ProfileScope LOOP_PROFILE_CONCAT(profile_scope_, __LINE__){name}
+#define LOOP_PROFILE_FUNCTION() LOOP_PROFILE_SCOPE(__func__)
+#define LOOP_PROFILE_THREAD(name) ::LoopEngine::Profiler::set_thread_name(name)
+#else
+#define LOOP_PROFILE_SCOPE(name) do {} while (false)
+#define LOOP_PROFILE_FUNCTION() do {} while (false)
+#define LOOP_PROFILE_THREAD(name) do {} while (false)
+#endif
+
+namespace LoopEngine::Profiler {
+    // Every thread records into its own fixed size ring buffer, older events are overwritten.
+    // The buffers are linked into a lock-free list the first time a thread records an event,
+    // so recording never takes a lock and the exporter can walk them from any thread.
+    inline constexpr size_t thread_event_capacity = 16384;
+
+    [[nodiscard]] extern auto get_time() -> uint64_t;
+    extern void record_event(const char* name, uint64_t begin, uint64_t end);
+    extern void set_thread_name(const std::string& name);
+
+    // writes the events still held by the ring buffers in the Chrome trace event format,
+    // the file can be opened with chrome://tracing or https://ui.perfetto.dev
+    extern auto save_chrome_trace(const std::string& filename) -> bool;
+
+    struct ProfileScope {
+        template<size_t N>
+        explicit ProfileScope(const char (&name)[N]) : name(name), begin(get_time()) {}
+
+        ~ProfileScope() {
+            record_event(name, begin, get_time());
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* name;
+        uint64_t begin;
+    };
+}
@@ -18,12 +18,14 @@ using LoopEngine::Graphics::Context;
 using LoopEngine::Graphics::Graphics;
 
 void ImGuiPlugin::on_create() {
+    // the font atlas takes one set, the rest is left for textures added by the application
     vk::DescriptorPoolSize pool_size{};
     pool_size.setType(vk::DescriptorType::eCombinedImageSampler);
-    pool_size.setDescriptorCount(1);
+    pool_size.setDescriptorCount(64);
 
     vk::DescriptorPoolCreateInfo pool_info{};
-    pool_info.setMaxSets(1);
+    pool_info.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
+    pool_info.setMaxSets(64);
     pool_info.setPoolSizeCount(1);
     pool_info.setPPoolSizes(&pool_size);
     imgui_descriptor_pool = Context::get_instance()->device.createDescriptorPool(pool_info);
@@ -34,7 +36,9 @@ void ImGuiPlugin::on_create() {
     ImGui_ImplVulkan_LoadFunctions([](const char* function_name, void*) {
         return Context::get_instance()->instance.getProcAddr(function_name);
     });
-    ImGui_ImplGlfw_InitForVulkan(Application::get_instance()->get_window().get_native_handle(), true);
+    if (!Application::get_instance()->get_window().is_headless()) {
+        ImGui_ImplGlfw_InitForVulkan(Application::get_instance()->get_window().get_native_handle(), true);
+    }
 
     ImGui_ImplVulkan_InitInfo info{};
     info.Instance = Context::get_instance()->instance;
@@ -48,7 +52,7 @@ void ImGuiPlugin::on_create() {
     info.CheckVkResultFn = [](VkResult result) {
         check(vk::Result(result));
     };
-    ImGui_ImplVulkan_Init(&info, Graphics::get_instance()->get_default_render_pass());
+    ImGui_ImplVulkan_Init(&info, Graphics::get_instance()->get_ui_render_pass());
 
     ImGui::GetIO().Fonts->AddFontDefault();
 
@@ -59,7 +63,14 @@ void ImGuiPlugin::on_create() {
 
 void ImGuiPlugin::on_update(float dt) {
     ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+    if (Application::get_instance()->get_window().is_headless()) {
+        // the platform backend normally provides the display size and the frame time
+        auto extent = Graphics::get_instance()->get_surface_extent();
+        ImGui::GetIO().DisplaySize = ImVec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+        ImGui::GetIO().DeltaTime = dt > 0.0f ? dt : 1.0f / 60.0f;
+    } else {
+        ImGui_ImplGlfw_NewFrame();
+    }
     ImGui::NewFrame();
 
     EventSystem::get_global_event_queue()->send_event(ImGuiDrawEvent{});
@@ -75,6 +86,8 @@ void ImGuiPlugin::on_destroy() {
     Context::get_instance()->device.destroyDescriptorPool(imgui_descriptor_pool);
 
     ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if (!Application::get_instance()->get_window().is_headless()) {
+        ImGui_ImplGlfw_Shutdown();
+    }
     ImGui::DestroyContext();
 }
\ No newline at end of file
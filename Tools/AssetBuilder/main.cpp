@@ -1,7 +1,9 @@
 #include <unordered_map>
 #include <filesystem>
 #include <fstream>
+#include <vector>
 #include <array>
+#include <string_view>
 
 #include "yaml-cpp/yaml.h"
 #include "spdlog/spdlog.h"
@@ -26,24 +28,41 @@ struct AssetInfo {
 
 auto main(int argc, char** argv) -> int {
     if (argc < 4) {
-        spdlog::error("Usage: {} <assets_binary_file> <assets_yaml_file> <assets_dir> <assets_files>", argv[0]);
+        spdlog::error("Usage: {} <assets_binary_file> <assets_yaml_file> <assets_dir> [--root <dir>]... <assets_files>", argv[0]);
         return 1;
     }
 
+    // asset names are relative to the first root that contains the file, e.g. the engine assets next to the application ones
+    std::vector<std::filesystem::path> roots{argv[3]};
+    std::vector<std::filesystem::path> files{};
+    for (int i = 4; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--root" && i + 1 < argc) {
+            roots.emplace_back(argv[++i]);
+        } else {
+            files.emplace_back(argv[i]);
+        }
+    }
+
     std::ofstream bin_file(argv[1], std::ios::binary);
 
     size_t offset = 0;
     std::unordered_map<std::string, AssetInfo> assets{};
 
-    for (int i = 4; i < argc; ++i) {
-        auto file_path = std::filesystem::path(argv[i]);
+    for (auto& file_path : files) {
         if (!std::filesystem::is_regular_file(file_path)) {
             continue;
         }
 
-        auto relative_path = file_path.lexically_relative(argv[3]);
+        auto relative_path = file_path.lexically_relative(roots.front());
+        for (auto& root : roots) {
+            auto path = file_path.lexically_relative(root);
+            if (!path.empty() && *path.begin() != "..") {
+                relative_path = path;
+                break;
+            }
+        }
 
-        if (file_path.extension() == ".vert" || file_path.extension() == ".frag") {
+        if (file_path.extension() == ".vert" || file_path.extension() == ".frag" || file_path.extension() == ".comp") {
             spdlog::info("Compile shader '{}'", relative_path.native());
 
             std::string output;
@@ -0,0 +1,262 @@
+#include "LoopEngine/Event/EventSystem.hpp"
+
+#include <array>
+#include <chrono>
+#include <tuple>
+#include <thread>
+#include <utility>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "spdlog/spdlog.h"
+
+using LoopEngine::Event::Delegate;
+using LoopEngine::Event::EventQueue;
+using LoopEngine::Event::EventChannel;
+using LoopEngine::Event::EventHandler;
+using LoopEngine::Event::LambdaEventHandler;
+
+// handlers and dispatch as they were before event type ids and typed delegate lists, kept as the baseline
+struct IVirtualEventHandler {
+    virtual void handle(void *payload) = 0;
+};
+
+template<typename T>
+struct VirtualEventHandler : IVirtualEventHandler {
+    using Event = T;
+
+    void connect(void(*function)(const Event&)) {
+        delegate = Delegate{function};
+    }
+
+private:
+    void handle(void *payload) override {
+        if (delegate) {
+            delegate(*static_cast<const Event*>(payload));
+        }
+    }
+
+    Delegate<void(const Event&)> delegate;
+};
+
+struct HashedEventQueue {
+    template<typename T>
+    using Handler = VirtualEventHandler<T>;
+
+    template<typename Event>
+    void send_event(const Event &event) {
+        auto it = handlers.find(typeid(Event).hash_code());
+        if (it != handlers.end()) {
+            for (auto &handler: it->second) {
+                handler->handle((void *) std::addressof(event));
+            }
+        }
+    }
+
+    template<typename Self>
+    void add_event_handler(Self *handler) {
+        handlers[typeid(typename Self::Event).hash_code()].emplace_back(handler);
+    }
+
+private:
+    std::unordered_map<size_t, std::vector<IVirtualEventHandler *>> handlers{};
+};
+
+struct IndexedEventQueue : EventQueue {
+    template<typename T>
+    using Handler = EventHandler<T>;
+};
+
+template<size_t index>
+struct DummyEvent {
+    float value;
+};
+
+struct HotEvent {
+    float value;
+};
+
+static constexpr size_t handler_count = 4;
+static constexpr size_t event_count = 10'000'000;
+
+static float sink = 0.0f;
+
+template<typename Queue>
+struct Fixture {
+    Fixture() {
+        // other event types share the table like in a real application
+        std::apply([this](auto&... handlers) {
+            (queue.add_event_handler(&handlers), ...);
+        }, dummy_handlers);
+        for (auto& handler : hot_handlers) {
+            handler.connect(+[](const HotEvent& event) {
+                sink += event.value;
+            });
+            queue.add_event_handler(&handler);
+        }
+    }
+
+    template<size_t... indices>
+    static auto make_dummy_handlers(std::index_sequence<indices...>) -> std::tuple<typename Queue::template Handler<DummyEvent<indices>>...>;
+
+    Queue queue{};
+    // every queue owns its registrations, a handler is only ever added to a single queue
+    decltype(make_dummy_handlers(std::make_index_sequence<16>{})) dummy_handlers{};
+    std::array<typename Queue::template Handler<HotEvent>, handler_count> hot_handlers{};
+};
+
+template<typename Queue>
+static auto measure(const char* name) -> double {
+    Fixture<Queue> fixture{};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < event_count; i++) {
+        fixture.queue.send_event(HotEvent{1.0f});
+    }
+    auto time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    auto per_event = time / static_cast<double>(event_count);
+    spdlog::info("{}: {:.2f} ns per event ({} handlers)", name, per_event, handler_count);
+    return per_event;
+}
+
+// events posted during a frame and flushed at once, like the particle deaths of an update
+static auto measure_posted(const char* name, size_t batch_size) -> double {
+    Fixture<IndexedEventQueue> fixture{};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < event_count; i += batch_size) {
+        for (size_t j = 0; j < batch_size; j++) {
+            fixture.queue.post_event(HotEvent{1.0f});
+        }
+        fixture.queue.flush_events();
+    }
+    auto time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    auto per_event = time / static_cast<double>(event_count);
+    spdlog::info("{}: {:.2f} ns per event ({} handlers, {} events per flush)", name, per_event, handler_count, batch_size);
+    return per_event;
+}
+
+// worker threads send through a channel while the main thread drains it, every event is checked to arrive once
+static auto measure_channel(size_t producer_count) -> double {
+    Fixture<IndexedEventQueue> fixture{};
+    EventChannel channel{4096};
+
+    size_t received = 0;
+    auto token = fixture.queue.add_event_handler<HotEvent>(Delegate{&received, +[](size_t* received, const HotEvent&) {
+        *received += 1;
+    }});
+
+    auto events_per_producer = event_count / producer_count;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> producers{};
+    for (size_t i = 0; i < producer_count; i++) {
+        producers.emplace_back([&channel, events_per_producer] {
+            for (size_t j = 0; j < events_per_producer; j++) {
+                while (!channel.try_send(HotEvent{1.0f})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    while (received < events_per_producer * producer_count) {
+        if (channel.drain(fixture.queue) == 0) {
+            std::this_thread::yield();
+        }
+        fixture.queue.flush_events();
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    auto time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    fixture.queue.remove_event_handler(token);
+
+    auto per_event = time / static_cast<double>(received);
+    spdlog::info("channel: {:.2f} ns per event ({} producers, {} handlers)", per_event, producer_count, handler_count);
+    return per_event;
+}
+
+// lambdas are stored inside of the handler, both connected before and after the handler is added
+static auto check_lambda_handlers() -> bool {
+    IndexedEventQueue queue{};
+
+    float before_sum = 0.0f;
+    LambdaEventHandler<HotEvent> before{};
+    before.connect([&before_sum](const HotEvent& event) {
+        before_sum += event.value;
+    });
+    queue.add_event_handler(&before);
+
+    float after_sum = 0.0f;
+    LambdaEventHandler<HotEvent> after{};
+    queue.add_event_handler(&after);
+    after.connect([&after_sum](const HotEvent& event) {
+        after_sum += event.value;
+    });
+
+    queue.send_event(HotEvent{1.0f});
+    queue.post_event(HotEvent{2.0f});
+    queue.flush_events();
+
+    queue.remove_event_handler(&before);
+    queue.remove_event_handler(&after);
+
+    if (before_sum != 3.0f || after_sum != 3.0f) {
+        spdlog::error("lambda handlers received {} and {} instead of 3", before_sum, after_sum);
+        return false;
+    }
+    return true;
+}
+
+// a handler that removes itself and the next one during dispatch, the one after them is still called once
+static auto check_removal_during_dispatch() -> bool {
+    IndexedEventQueue queue{};
+
+    std::array<LambdaEventHandler<HotEvent>, 3> handlers{};
+    std::array<int, 3> calls{};
+    handlers[0].connect([&queue, &handlers, &calls](const HotEvent& event) {
+        calls[0] += 1;
+        queue.remove_event_handler(&handlers[0]);
+        queue.remove_event_handler(&handlers[1]);
+    });
+    handlers[1].connect([&calls](const HotEvent& event) {
+        calls[1] += 1;
+    });
+    handlers[2].connect([&calls](const HotEvent& event) {
+        calls[2] += 1;
+    });
+    for (auto& handler : handlers) {
+        queue.add_event_handler(&handler);
+    }
+
+    queue.send_event(HotEvent{1.0f});
+    queue.send_event(HotEvent{1.0f});
+    queue.remove_event_handler(&handlers[2]);
+
+    if (calls[0] != 1 || calls[1] != 0 || calls[2] != 2) {
+        spdlog::error("handlers were called {}, {} and {} times instead of 1, 0 and 2", calls[0], calls[1], calls[2]);
+        return false;
+    }
+    return true;
+}
+
+auto main() -> int {
+    if (!check_lambda_handlers() || !check_removal_during_dispatch()) {
+        return 1;
+    }
+
+    auto hashed = measure<HashedEventQueue>("hashed type lookup, virtual handlers");
+    auto indexed = measure<IndexedEventQueue>("dense type id, typed delegates");
+    spdlog::info("speedup {:.2f}x", hashed / indexed);
+
+    auto posted = measure_posted("posted and flushed", 1000);
+    spdlog::info("speedup {:.2f}x", hashed / posted);
+
+    for (size_t producer_count : {1, 2, 4}) {
+        measure_channel(producer_count);
+    }
+    return sink > 0.0f ? 0 : 1;
+}
@@ -4,49 +4,53 @@
 #include "LoopEngine/Graphics/Graphics.hpp"
 #include "LoopEngine/Graphics/IndexBuffer.hpp"
 #include "LoopEngine/Graphics/VertexBuffer.hpp"
+#include "LoopEngine/Camera/CameraSystem.hpp"
 #include "spdlog/spdlog.h"
 #include "glm/vec3.hpp"
 
-using LoopEngine::Graphics::create_index_buffer;
-using LoopEngine::Graphics::update_index_buffer;
+using LoopEngine::Graphics::upload_index_buffer;
+using LoopEngine::Graphics::create_static_index_buffer;
 using LoopEngine::Graphics::release_index_buffer;
-using LoopEngine::Graphics::create_vertex_buffer;
-using LoopEngine::Graphics::update_vertex_buffer;
+using LoopEngine::Graphics::upload_vertex_buffer;
+using LoopEngine::Graphics::create_static_vertex_buffer;
 using LoopEngine::Graphics::release_vertex_buffer;
-using LoopEngine::Graphics::get_material_from_assets;
-using LoopEngine::Graphics::bind_global_descriptor_sets;
-
-ParticleSystem::ParticleSystem(size_t capacity)  {
-    positions.resize(capacity);
-    particles.resize(capacity);
+using LoopEngine::Graphics::DrawPacket;
+using LoopEngine::Graphics::RenderLayer;
+using LoopEngine::Camera::get_default_camera;
+using LoopEngine::Culling::cull_spheres;
+using LoopEngine::Culling::get_camera_frustum;
 
+ParticleMesh::ParticleMesh() {
     std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
 
-    ibo = create_index_buffer(sizeof(uint32_t) * indices.size());
-    update_index_buffer(*ibo, indices.data(), sizeof(uint32_t) * indices.size());
+    ibo = create_static_index_buffer(sizeof(uint32_t) * indices.size());
+    upload_index_buffer(*ibo, indices.data(), sizeof(uint32_t) * indices.size());
 
     std::vector<float> vertices{
-        -0.05f, -0.05f, 0.0f,
-        -0.05f,  0.05f, 0.0f,
-        0.05f,  0.05f, 0.0f,
-        0.05f, -0.05f, 0.0f
+        -half_extent, -half_extent, 0.0f,
+        -half_extent,  half_extent, 0.0f,
+        half_extent,  half_extent, 0.0f,
+        half_extent, -half_extent, 0.0f
     };
 
-    vbo[0] = create_vertex_buffer(sizeof(float) * vertices.size());
-    vbo[1] = create_vertex_buffer(sizeof(VertexData) * positions.size());
-
-    update_vertex_buffer(*vbo[0], vertices.data(), sizeof(float) * vertices.size());
-
-    material = get_material_from_assets("materials/particles.material");
+    vbo = create_static_vertex_buffer(sizeof(float) * vertices.size());
+    upload_vertex_buffer(*vbo, vertices.data(), sizeof(float) * vertices.size());
 }
 
-ParticleSystem::~ParticleSystem() {
+ParticleMesh::~ParticleMesh() {
     release_index_buffer(*ibo);
-    release_vertex_buffer(*vbo[0]);
-    release_vertex_buffer(*vbo[1]);
-    release_material(*material);
+    release_vertex_buffer(*vbo);
+}
+
+ParticleSystem::ParticleSystem(size_t capacity, std::shared_ptr<Material> material, std::shared_ptr<ParticleMesh> mesh) : material(std::move(material)), mesh(std::move(mesh)) {
+    positions.resize(capacity);
+    particles.resize(capacity);
+    bounds.reserve(capacity);
+    visible_positions.reserve(capacity);
 }
 
+ParticleSystem::~ParticleSystem() = default;
+
 void ParticleSystem::emit(const glm::vec3 &position, const glm::vec4 &color, const glm::vec3 &velocity, float lifetime) {
     // find an empty slot
     int index = -1;
@@ -70,6 +74,7 @@ void ParticleSystem::update(float dt) {
     event_queue.send_event(ParticleSystemUpdateEvent{dt });
 
     count = 0;
+    bounds.clear();
     for (auto& particle : particles) {
         if (particle.lifetime <= 0.0f) {
             continue;
@@ -78,23 +83,44 @@ void ParticleSystem::update(float dt) {
         particle.position += particle.velocity * dt;
         positions[count].position = particle.position;
         positions[count].color = particle.color;
+        bounds.add(particle.position, ParticleMesh::bounding_radius);
         count++;
         if (particle.lifetime <= 0.0f) {
-            event_queue.send_event(ParticleDeathEvent{particle });
+            event_queue.post_event(ParticleDeathEvent{particle});
         }
     }
-    if (count > 0) {
-        update_vertex_buffer(*vbo[1], positions.data(), sizeof(VertexData) * count);
-    }
+
+    // the handlers see all particles that died in this update at once
+    event_queue.flush_events();
 }
 
-void ParticleSystem::draw(vk::CommandBuffer cmd) {
+void ParticleSystem::submit(RenderQueue& queue) {
     if (count == 0) {
         return;
     }
-    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, material->pipeline);
-    bind_global_descriptor_sets(cmd, *material, 0);
-    cmd.bindVertexBuffers(0, {vbo[0]->handle, vbo[1]->handle}, {0, 0});
-    cmd.bindIndexBuffer(ibo->handle, 0, vk::IndexType::eUint32);
-    cmd.drawIndexed(6, count, 0, 0, 0);
+
+    cull_spheres(get_camera_frustum(*get_default_camera()), bounds, visible);
+    if (visible.empty()) {
+        return;
+    }
+
+    visible_positions.clear();
+    for (auto index : visible) {
+        visible_positions.push_back(positions[index]);
+    }
+
+    // particles are blended additively, so the order only matters for grouping by material,
+    // the positions are gathered into the shared instance buffer when the frame is recorded
+    DrawPacket packet{};
+    packet.key = RenderQueue::make_sort_key(RenderLayer::Transparent, *material, 0.0f);
+    packet.material = material.get();
+    packet.vertex_buffers[0] = mesh->vbo->handle;
+    packet.vertex_buffer_count = 2;
+    packet.index_buffer = mesh->ibo->handle;
+    packet.count = 6;
+    packet.instance_count = static_cast<uint32_t>(visible_positions.size());
+    packet.instance_data = visible_positions.data();
+    packet.instance_stride = sizeof(VertexData);
+    packet.instance_binding = 1;
+    queue.submit(packet);
 }
\ No newline at end of file
@@ -2,14 +2,17 @@
 
 #include <vector>
 #include <memory>
+#include <numbers>
 
 #include "glm/glm.hpp"
 
 #include "LoopEngine/Event/EventSystem.hpp"
 #include "LoopEngine/Graphics/Material.hpp"
 #include "LoopEngine/Graphics/Context.hpp"
+#include "LoopEngine/Graphics/RenderQueue.hpp"
 #include "LoopEngine/Graphics/IndexBuffer.hpp"
 #include "LoopEngine/Graphics/VertexBuffer.hpp"
+#include "LoopEngine/Culling/FrustumCulling.hpp"
 
 using LoopEngine::Event::InitEvent;
 using LoopEngine::Event::DrawEvent;
@@ -17,6 +20,7 @@ using LoopEngine::Event::QuitEvent;
 using LoopEngine::Event::UpdateEvent;
 
 using LoopEngine::Graphics::Material;
+using LoopEngine::Graphics::RenderQueue;
 using LoopEngine::Graphics::IndexBuffer;
 using LoopEngine::Graphics::VertexBuffer;
 
@@ -36,17 +40,34 @@ struct ParticleSpawnEvent {
     Particle& particle;
 };
 
+// posted while the particles are updated, so it holds a copy of the particle
 struct ParticleDeathEvent {
-    Particle& particle;
+    Particle particle;
+};
+
+// quad shared by particle systems, so the render queue can merge their draws
+struct ParticleMesh {
+    // the quad is a billboard facing the camera
+    static constexpr float half_extent = 0.05f;
+    // radius of the sphere around the quad, used as the culling bounds of a particle
+    static constexpr float bounding_radius = half_extent * std::numbers::sqrt2_v<float>;
+
+    ParticleMesh();
+    ~ParticleMesh();
+
+    std::shared_ptr<IndexBuffer> ibo{};
+    std::shared_ptr<VertexBuffer> vbo{};
 };
 
 struct ParticleSystem {
-    explicit ParticleSystem(size_t capacity);
+    // the material is shared by systems drawn with the same pipeline and released by its owner
+    ParticleSystem(size_t capacity, std::shared_ptr<Material> material, std::shared_ptr<ParticleMesh> mesh);
     ~ParticleSystem();
 
     void emit(const glm::vec3& position, const glm::vec4 &color, const glm::vec3 &velocity, float lifetime);
     void update(float dt);
-    void draw(vk::CommandBuffer cmd);
+    // only the particles inside the frustum of the default camera are submitted
+    void submit(RenderQueue& queue);
 
     [[nodiscard]] auto get_particles() -> std::span<Particle> {
         return particles;
@@ -70,6 +91,15 @@ struct ParticleSystem {
         event_queue.remove_event_handler(handler);
     }
 
+    template<typename T>
+    auto add_batch_event_handler(LoopEngine::Event::Delegate<void(std::span<const T>)> delegate) -> LoopEngine::Event::EventHandlerToken {
+        return event_queue.add_batch_event_handler<T>(delegate);
+    }
+
+    void remove_event_handler(LoopEngine::Event::EventHandlerToken token) {
+        event_queue.remove_event_handler(token);
+    }
+
 private:
     struct VertexData {
         alignas(16) glm::vec3 position;
@@ -79,9 +109,11 @@ private:
     std::vector<VertexData> positions{};
     size_t count = 0;
 
-    std::shared_ptr<IndexBuffer> ibo{};
-    std::shared_ptr<VertexBuffer> vbo[2]{};
+    LoopEngine::Culling::BoundingSpheres bounds{};
+    std::vector<uint32_t> visible{};
+    std::vector<VertexData> visible_positions{};
 
     std::shared_ptr<Material> material{};
+    std::shared_ptr<ParticleMesh> mesh{};
     LoopEngine::Event::EventQueue event_queue{};
 };
\ No newline at end of file
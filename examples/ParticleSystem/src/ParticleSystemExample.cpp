@@ -6,6 +6,9 @@
 #include "LoopEngine/Input/InputSystem.hpp"
 #include "LoopEngine/Platform/Window.hpp"
 #include "LoopEngine/Application.hpp"
+#include "LoopEngine/Graphics/GpuCulling.hpp"
+#include "LoopEngine/Graphics/MemoryStats.hpp"
+#include "LoopEngine/Profiler/CpuProfiler.hpp"
 #include "spdlog/spdlog.h"
 #include "glm/vec3.hpp"
 #include "imgui.h"
@@ -14,33 +17,62 @@ using LoopEngine::Application;
 using LoopEngine::Platform::Window;
 using LoopEngine::Input::InputSystem;
 using LoopEngine::Event::EventSystem;
+using LoopEngine::Event::EventHandlerToken;
+using LoopEngine::Event::create_delegate;
 using LoopEngine::Graphics::check;
 using LoopEngine::Graphics::Context;
 using LoopEngine::Graphics::Graphics;
+using LoopEngine::Graphics::RenderQueue;
+using LoopEngine::Graphics::RenderGraph;
+using LoopEngine::Graphics::GpuCulling;
+using LoopEngine::Graphics::GpuCullingObject;
+using LoopEngine::Graphics::CommandRecorder;
+using LoopEngine::Graphics::FrameGraphStage;
+using LoopEngine::Graphics::bind_global_descriptor_sets;
+using LoopEngine::Graphics::upload_vertex_buffer;
+using LoopEngine::Graphics::release_vertex_buffer;
+using LoopEngine::Graphics::create_static_vertex_buffer;
+using LoopEngine::Graphics::release_material;
+using LoopEngine::Graphics::get_material_from_assets;
+using LoopEngine::Graphics::LatencyProfile;
+using LoopEngine::Graphics::get_latency_profile_name;
+using LoopEngine::Graphics::MemoryCategory;
+using LoopEngine::Graphics::get_memory_stats;
+using LoopEngine::Graphics::save_memory_stats_json;
+using LoopEngine::Graphics::get_memory_category_name;
+using LoopEngine::Graphics::memory_category_count;
 using LoopEngine::Camera::get_default_camera;
 
 struct FireworkParticleSystem {
     FireworkParticleSystem() {
-        rocket_particle_system = std::make_shared<ParticleSystem>(1000);
-        rocket_particle_system->add_event_handler(&rocket_particle_death_handler);
+        // all systems share one material and mesh, so the render queue merges them into one draw
+        material = get_material_from_assets("materials/particles.material");
+        mesh = std::make_shared<ParticleMesh>();
+
+        rocket_particle_system = std::make_shared<ParticleSystem>(1000, material, mesh);
+        rocket_particle_death_token = rocket_particle_system->add_batch_event_handler<ParticleDeathEvent>(create_delegate<&FireworkParticleSystem::on_rocket_particle_deaths>(this));
         rocket_particle_system->add_event_handler(&rocket_particle_system_update_handler);
-        rocket_particle_death_handler.connect<&FireworkParticleSystem::on_rocket_particle_death>(this);
         rocket_particle_system_update_handler.connect<&FireworkParticleSystem::on_rocket_particle_system_update>(this);
 
-        sparkle_particle_system = std::make_shared<ParticleSystem>(1000);
+        sparkle_particle_system = std::make_shared<ParticleSystem>(1000, material, mesh);
         sparkle_particle_system->add_event_handler(&sparkle_particle_system_update_handler);
         sparkle_particle_system_update_handler.connect<&FireworkParticleSystem::on_sparkle_particle_system_update>(this);
 
-        explosion_particle_system = std::make_shared<ParticleSystem>(1000);
+        explosion_particle_system = std::make_shared<ParticleSystem>(1000, material, mesh);
         explosion_particle_system->add_event_handler(&explosion_particle_system_update_handler);
         explosion_particle_system_update_handler.connect<&FireworkParticleSystem::on_explosion_particle_system_update>(this);
     }
 
     ~FireworkParticleSystem() {
         rocket_particle_system->remove_event_handler(&rocket_particle_system_update_handler);
-        rocket_particle_system->remove_event_handler(&rocket_particle_death_handler);
+        rocket_particle_system->remove_event_handler(rocket_particle_death_token);
         sparkle_particle_system->remove_event_handler(&sparkle_particle_system_update_handler);
         explosion_particle_system->remove_event_handler(&explosion_particle_system_update_handler);
+
+        rocket_particle_system.reset();
+        sparkle_particle_system.reset();
+        explosion_particle_system.reset();
+        release_material(*material);
     }
 
     void update(float dt) {
@@ -49,13 +81,14 @@ struct FireworkParticleSystem {
         explosion_particle_system->update(dt);
     }
 
-    void draw(vk::CommandBuffer cmd) {
-        rocket_particle_system->draw(cmd);
-        sparkle_particle_system->draw(cmd);
-        explosion_particle_system->draw(cmd);
+    void submit(RenderQueue& queue) {
+        rocket_particle_system->submit(queue);
+        sparkle_particle_system->submit(queue);
+        explosion_particle_system->submit(queue);
     }
 
 private:
+
     void on_rocket_particle_system_update(const ParticleSystemUpdateEvent& event) {
         emit_delay += event.dt;
         while (emit_delay >= emit_rate) {
@@ -114,17 +147,19 @@ private:
         }
     }
 
-    void on_rocket_particle_death(const ParticleDeathEvent& event) {
-        for (int i = 0; i < 250; ++i) {
-            glm::vec3 velocity{};
-            velocity.x = std::uniform_real_distribution(-1.0f, 1.0f)(generator) * 5.f;
-            velocity.y = std::uniform_real_distribution(-1.0f, 1.0f)(generator) * 5.f;
-            velocity.z = std::uniform_real_distribution(-1.0f, 1.0f)(generator) * 5.f;
+    void on_rocket_particle_deaths(std::span<const ParticleDeathEvent> events) {
+        for (auto& event : events) {
+            for (int i = 0; i < 250; ++i) {
+                glm::vec3 velocity{};
+                velocity.x = std::uniform_real_distribution(-1.0f, 1.0f)(generator) * 5.f;
+                velocity.y = std::uniform_real_distribution(-1.0f, 1.0f)(generator) * 5.f;
+                velocity.z = std::uniform_real_distribution(-1.0f, 1.0f)(generator) * 5.f;
 
-            glm::vec4 color = event.particle.color;
-            color.w = 1.0f;
+                glm::vec4 color = event.particle.color;
+                color.w = 1.0f;
 
-            explosion_particle_system->emit(event.particle.position, color, velocity, 1.0f);
+                explosion_particle_system->emit(event.particle.position, color, velocity, 1.0f);
+            }
         }
     }
 
@@ -133,28 +168,116 @@ private:
     float emit_delay = 0.0f;
 
     std::default_random_engine generator{};
+    std::shared_ptr<Material> material{};
+    std::shared_ptr<ParticleMesh> mesh{};
     std::shared_ptr<ParticleSystem> rocket_particle_system{};
     std::shared_ptr<ParticleSystem> sparkle_particle_system{};
     std::shared_ptr<ParticleSystem> explosion_particle_system{};
     EventHandler<ParticleSystemUpdateEvent> rocket_particle_system_update_handler{};
     EventHandler<ParticleSystemUpdateEvent> sparkle_particle_system_update_handler{};
     EventHandler<ParticleSystemUpdateEvent> explosion_particle_system_update_handler{};
-    EventHandler<ParticleDeathEvent> rocket_particle_death_handler{};
+    EventHandlerToken rocket_particle_death_token{};
+};
+
+// static stars culled and drawn on the GPU, the CPU records one indirect draw for all of them
+struct Starfield {
+    static constexpr uint32_t star_count = 100000;
+
+    struct StarData {
+        alignas(16) glm::vec3 position;
+        glm::vec4 color;
+    };
+
+    Starfield() : gpu_culling(*Context::get_instance()) {
+        material = get_material_from_assets("materials/particles.material");
+        mesh = std::make_shared<ParticleMesh>();
+
+        std::default_random_engine generator{};
+        std::vector<StarData> stars(star_count);
+        std::vector<GpuCullingObject> objects(star_count);
+        for (uint32_t i = 0; i < star_count; i++) {
+            glm::vec3 direction{};
+            direction.x = std::uniform_real_distribution(-1.0f, 1.0f)(generator);
+            direction.y = std::uniform_real_distribution(-1.0f, 1.0f)(generator);
+            direction.z = std::uniform_real_distribution(-1.0f, 1.0f)(generator);
+
+            auto distance = std::uniform_real_distribution(100.0f, 400.0f)(generator);
+            auto brightness = std::uniform_real_distribution(0.25f, 1.0f)(generator);
+
+            stars[i].position = glm::normalize(direction + glm::vec3(0.0f, 0.0f, 1e-3f)) * distance;
+            stars[i].color = glm::vec4(brightness, brightness, brightness, 1.0f);
+
+            objects[i].bounds = glm::vec4(stars[i].position, ParticleMesh::bounding_radius);
+            objects[i].index_count = 6;
+        }
+
+        instances = create_static_vertex_buffer(sizeof(StarData) * stars.size());
+        upload_vertex_buffer(*instances, stars.data(), sizeof(StarData) * stars.size());
+
+        gpu_culling.initialize(Graphics::get_instance()->get_frame_pacing().get_frame_capacity(), star_count);
+        gpu_culling.set_objects(objects);
+        Graphics::get_instance()->invalidate_frame_graph();
+    }
+
+    ~Starfield() {
+        gpu_culling.terminate();
+        release_vertex_buffer(*instances);
+        mesh.reset();
+        release_material(*material);
+    }
+
+    void add_pass(RenderGraph& graph) {
+        gpu_culling.add_pass(graph);
+    }
+
+    void draw(CommandRecorder& recorder) {
+        auto frame = Graphics::get_instance()->get_current_frame();
+        recorder.record([this, frame](vk::CommandBuffer cmd) {
+            cmd.bindPipeline(material->bind_point, material->pipeline);
+            bind_global_descriptor_sets(cmd, *material, 0);
+            std::array<vk::Buffer, 2> buffers{mesh->vbo->handle, instances->handle};
+            std::array<vk::DeviceSize, 2> offsets{};
+            cmd.bindVertexBuffers(0, buffers, offsets);
+            cmd.bindIndexBuffer(mesh->ibo->handle, 0, vk::IndexType::eUint32);
+            // the star data are instanced attributes, they need the object index as the first instance of the draws
+            if (Context::get_instance()->draw_indirect_first_instance_supported) {
+                gpu_culling.draw(cmd, frame);
+            } else {
+                cmd.drawIndexed(6, star_count, 0, 0, 0);
+            }
+        });
+    }
+
+private:
+    GpuCulling gpu_culling;
+    std::shared_ptr<Material> material{};
+    std::shared_ptr<ParticleMesh> mesh{};
+    std::shared_ptr<VertexBuffer> instances{};
 };
 
 ParticleSystemExample::ParticleSystemExample() {
     imgui_draw_event_handler.connect<&ParticleSystemExample::on_imgui_draw>(this);
     press_button_event_handler.connect<&ParticleSystemExample::on_press_button>(this);
+    render_queue_event_handler.connect<&ParticleSystemExample::on_render_queue>(this);
+    parallel_draw_event_handler.connect<&ParticleSystemExample::on_parallel_draw>(this);
+    frame_graph_setup_event_handler.connect<&ParticleSystemExample::on_frame_graph_setup>(this);
 
     EventSystem::get_global_event_queue()->add_event_handler(&imgui_draw_event_handler);
     EventSystem::get_global_event_queue()->add_event_handler(&press_button_event_handler);
+    EventSystem::get_global_event_queue()->add_event_handler(&render_queue_event_handler);
+    EventSystem::get_global_event_queue()->add_event_handler(&parallel_draw_event_handler);
+    EventSystem::get_global_event_queue()->add_event_handler(&frame_graph_setup_event_handler);
 
     firework_particle_system = std::make_shared<FireworkParticleSystem>();
+    starfield = std::make_shared<Starfield>();
 }
 
 ParticleSystemExample::~ParticleSystemExample() {
     EventSystem::get_global_event_queue()->remove_event_handler(&imgui_draw_event_handler);
     EventSystem::get_global_event_queue()->remove_event_handler(&press_button_event_handler);
+    EventSystem::get_global_event_queue()->remove_event_handler(&render_queue_event_handler);
+    EventSystem::get_global_event_queue()->remove_event_handler(&parallel_draw_event_handler);
+    EventSystem::get_global_event_queue()->remove_event_handler(&frame_graph_setup_event_handler);
 }
 
 void ParticleSystemExample::on_create() {
@@ -169,11 +292,25 @@ void ParticleSystemExample::on_update(float dt) {
     firework_particle_system->update(dt);
 }
 
-void ParticleSystemExample::on_draw(vk::CommandBuffer cmd) {
-    firework_particle_system->draw(cmd);
+void ParticleSystemExample::on_render_queue(const RenderQueueEvent& event) {
+    firework_particle_system->submit(event.queue);
+}
+
+void ParticleSystemExample::on_parallel_draw(const ParallelDrawEvent& event) {
+    starfield->draw(event.recorder);
+}
+
+void ParticleSystemExample::on_frame_graph_setup(const FrameGraphSetupEvent& event) {
+    if (event.stage == FrameGraphStage::BeforeMainPass) {
+        starfield->add_pass(event.graph);
+    }
 }
 
 void ParticleSystemExample::update_camera(float dt) const {
+    if (Application::get_instance()->get_window().is_headless()) {
+        return;
+    }
+
     if (lock_mouse) {
         glfwSetInputMode(Application::get_instance()->get_window().get_native_handle(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     } else {
@@ -229,6 +366,88 @@ void ParticleSystemExample::on_press_button(const ButtonPressEvent& event) {
 void ParticleSystemExample::on_imgui_draw(const ImGuiDrawEvent& event) {
     ImGui::Begin("Particle System", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+    if (ImGui::CollapsingHeader("Frame pacing")) {
+        auto& frame_pacing = Graphics::get_instance()->get_frame_pacing();
+
+        auto profile = frame_pacing.get_profile();
+        if (ImGui::BeginCombo("Latency profile", get_latency_profile_name(profile))) {
+            for (auto option : {LatencyProfile::Throughput, LatencyProfile::Balanced, LatencyProfile::LowLatency}) {
+                if (ImGui::Selectable(get_latency_profile_name(option), option == profile)) {
+                    frame_pacing.set_profile(option);
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        auto frames_in_flight = static_cast<int>(frame_pacing.get_frames_in_flight());
+        if (ImGui::SliderInt("Frames in flight", &frames_in_flight, 1, static_cast<int>(frame_pacing.get_frame_capacity()))) {
+            frame_pacing.set_frames_in_flight(static_cast<size_t>(frames_in_flight));
+        }
+
+        auto frame_rate_limit = frame_pacing.get_frame_rate_limit();
+        if (ImGui::InputFloat("Frame rate limit", &frame_rate_limit, 10.0f, 60.0f, "%.0f")) {
+            frame_pacing.set_frame_rate_limit(frame_rate_limit);
+        }
+
+        auto& stats = frame_pacing.get_stats();
+        ImGui::Text("Frame time: %.2f ms", stats.frame_time);
+        ImGui::Text("Input to submit: %.2f ms", stats.submit_latency);
+        ImGui::Text("Input to GPU done: %.2f ms (max %.2f ms)", stats.gpu_latency, stats.max_gpu_latency);
+    }
+
+    if (ImGui::Button("Save CPU trace")) {
+        LoopEngine::Profiler::save_chrome_trace("cpu_trace.json");
+    }
+
+    if (ImGui::CollapsingHeader("GPU")) {
+        auto& gpu_profiler = Graphics::get_instance()->get_gpu_profiler();
+        if (!gpu_profiler.is_supported()) {
+            ImGui::Text("Timestamps are not supported");
+        }
+        for (auto& stats : gpu_profiler.get_scope_stats()) {
+            ImGui::Text("%s: %.3f ms (min %.3f, avg %.3f, max %.3f)", stats.name.c_str(), stats.last_time, stats.min_time, stats.avg_time, stats.max_time);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Dynamic resolution")) {
+        auto& dynamic_resolution = Graphics::get_instance()->get_dynamic_resolution();
+
+        auto enabled = dynamic_resolution.is_enabled();
+        if (ImGui::Checkbox("Enabled", &enabled)) {
+            dynamic_resolution.set_enabled(enabled);
+        }
+
+        auto target_time = dynamic_resolution.get_target_time();
+        if (ImGui::SliderFloat("Target GPU time", &target_time, 1.0f, 33.0f, "%.1f ms")) {
+            dynamic_resolution.set_target_time(target_time);
+        }
+
+        auto min_scale = dynamic_resolution.get_min_scale();
+        if (ImGui::SliderFloat("Min scale", &min_scale, 0.25f, 1.0f, "%.2f")) {
+            dynamic_resolution.set_scale_range(min_scale, dynamic_resolution.get_max_scale());
+        }
+
+        auto extent = Graphics::get_instance()->get_render_extent();
+        ImGui::Text("Scale: %.2f (%ux%u)", dynamic_resolution.get_scale(), extent.width, extent.height);
+    }
+
+    if (ImGui::CollapsingHeader("Memory")) {
+        static constexpr auto MiB = 1024.0 * 1024.0;
+
+        auto& stats = get_memory_stats();
+        for (size_t i = 0; i < stats.heaps.size(); i++) {
+            auto& heap = stats.heaps[i];
+            ImGui::Text("Heap %zu: %.1f / %.1f MiB (peak %.1f MiB)", i, double(heap.usage) / MiB, double(heap.budget) / MiB, double(heap.peak_usage) / MiB);
+        }
+        for (size_t i = 0; i < memory_category_count; i++) {
+            auto& category = stats.categories[i];
+            ImGui::Text("%s: %zu allocations, %.1f MiB (peak %zu, %.1f MiB)", get_memory_category_name(MemoryCategory(i)), category.allocation_count, double(category.allocation_bytes) / MiB, category.peak_allocation_count, double(category.peak_allocation_bytes) / MiB);
+        }
+        if (ImGui::Button("Dump memory stats")) {
+            save_memory_stats_json("memory_stats.json", true);
+        }
+    }
     ImGui::End();
 }
 
@@ -6,6 +6,7 @@
 #include "LoopEngine/Lifecycle.hpp"
 #include "LoopEngine/Event/EventSystem.hpp"
 #include "LoopEngine/Input/InputSystem.hpp"
+#include "LoopEngine/Graphics/Graphics.hpp"
 
 #include "ParticleSystem.hpp"
 #include "ImGuiPlugin.hpp"
@@ -15,9 +16,13 @@ using LoopEngine::Event::DrawEvent;
 using LoopEngine::Event::UpdateEvent;
 using LoopEngine::Event::EventHandler;
 using LoopEngine::Input::ButtonPressEvent;
+using LoopEngine::Graphics::RenderQueueEvent;
+using LoopEngine::Graphics::ParallelDrawEvent;
+using LoopEngine::Graphics::FrameGraphSetupEvent;
 
 struct ImGuiDrawEvent;
 struct FireworkParticleSystem;
+struct Starfield;
 struct ParticleSystemExample : LoopEngine::Lifecycle<ParticleSystemExample> {
     friend Lifecycle;
 
@@ -27,13 +32,15 @@ struct ParticleSystemExample : LoopEngine::Lifecycle<ParticleSystemExample> {
 private:
     void on_create();
     void on_update(float dt);
-    void on_draw(vk::CommandBuffer cmd);
 
     void update_camera(float dt) const;
 
 private:
     void on_press_button(const ButtonPressEvent& event);
     void on_imgui_draw(const ImGuiDrawEvent& event);
+    void on_render_queue(const RenderQueueEvent& event);
+    void on_parallel_draw(const ParallelDrawEvent& event);
+    void on_frame_graph_setup(const FrameGraphSetupEvent& event);
 
 private:
     bool lock_mouse = false;
@@ -41,5 +48,9 @@ private:
     ImGuiPlugin imgui_plugin{};
     EventHandler<ImGuiDrawEvent> imgui_draw_event_handler{};
     EventHandler<ButtonPressEvent> press_button_event_handler{};
+    EventHandler<RenderQueueEvent> render_queue_event_handler{};
+    EventHandler<ParallelDrawEvent> parallel_draw_event_handler{};
+    EventHandler<FrameGraphSetupEvent> frame_graph_setup_event_handler{};
     std::shared_ptr<FireworkParticleSystem> firework_particle_system{};
+    std::shared_ptr<Starfield> starfield{};
 };
\ No newline at end of file